@@ -0,0 +1,109 @@
+#pragma once
+
+#include "phrase.h"
+
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+// A shared_ptr without a control block. Copying it costs no reference counting, 
+// and it does not keep p alive, so whatever owns p must outlive every copy
+template <class T>
+std::shared_ptr<T> borrowed(T* p) { return std::shared_ptr<T>(std::shared_ptr<void>(), p); }
+template <class T>
+std::shared_ptr<T> borrowed(const std::shared_ptr<T>& p) { return borrowed(p.get()); }
+
+// Bump allocator for the phrases built during one parse. Phrases are handed out 
+// as borrowed pointers that stay valid until reset, which destroys them all at once 
+// and keeps the memory for the next parse
+class PhraseArena
+{
+	struct Block
+	{
+		std::unique_ptr<char[]> data;
+		size_t size;
+	};
+	static constexpr size_t _block_size = 64 * 1024;
+
+	std::vector<Block> _blocks;
+	size_t _block = 0;
+	size_t _used = 0;
+	size_t _bytes = 0;
+	std::vector<Phrase*> _built;
+
+	void* _allocate(size_t size, size_t align)
+	{
+		for (;; ++_block, _used = 0)
+		{
+			if (_block == _blocks.size())
+			{
+				const auto block_size = std::max(_block_size, size + align);
+				_blocks.push_back({ std::make_unique<char[]>(block_size), block_size });
+			}
+			auto& block = _blocks[_block];
+			const size_t start = (_used + align - 1) / align * align;
+			if (start + size <= block.size)
+			{
+				_used = start + size;
+				_bytes += size;
+				return block.data.get() + start;
+			}
+		}
+	}
+public:
+	PhraseArena() = default;
+	PhraseArena(PhraseArena&&) = default;
+	PhraseArena& operator=(PhraseArena&&) = delete;
+	~PhraseArena() { reset(); }
+
+	template <class T, class... Args>
+	std::shared_ptr<T> make(Args&&... args)
+	{
+		const auto result = new (_allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+		_built.push_back(result);
+		return borrowed(result);
+	}
+
+	void reset()
+	{
+		for (auto it = _built.rbegin(); it != _built.rend(); ++it)
+			(*it)->~Phrase();
+		_built.clear();
+		_block = 0;
+		_used = 0;
+		_bytes = 0;
+	}
+
+	// bytes used by the phrases built since the last reset
+	size_t bytes() const { return _bytes; }
+
+	// the arena that phrases built by rules on this thread go to, if any
+	static PhraseArena*& current()
+	{
+		static thread_local PhraseArena* arena = nullptr;
+		return arena;
+	}
+
+	// makes an arena current on this thread while in scope
+	class Use
+	{
+		PhraseArena* _previous;
+	public:
+		explicit Use(PhraseArena& arena) : _previous(std::exchange(current(), &arena)) { }
+		~Use() { current() = _previous; }
+
+		Use(const Use&) = delete;
+		Use& operator=(const Use&) = delete;
+	};
+};
+
+// builds in the current arena, or on the heap when no parse is running on this thread
+template <class T, class... Args>
+std::shared_ptr<T> make_phrase(Args&&... args)
+{
+	if (auto arena = PhraseArena::current())
+		return arena->make<T>(std::forward<Args>(args)...);
+	return std::make_shared<T>(std::forward<Args>(args)...);
+}
@@ -0,0 +1,38 @@
+#include "batch.h"
+#include "tokenizer.h"
+
+std::vector<Parser::Phrases> parse_sentence(Parser& parser, std::string_view sentence, WordCache* cache)
+{
+	parser.clear();
+
+	Tokenizer<std::string_view> tokens{ sentence };
+	tokens.cache = cache;
+	while (auto word = tokens.next())
+		parser.push(*word);
+
+	return parser.run();
+}
+
+std::vector<std::vector<Parser::Phrases>> parse_batch(
+	const std::vector<std::string_view>& sentences, WorkPool& pool, Forest forest, WordCache* cache)
+{
+	std::vector<std::vector<Parser::Phrases>> results(sentences.size());
+	std::vector<Parser> parsers;
+	parsers.reserve(pool.size());
+	for (unsigned i = 0; i < pool.size(); ++i)
+		parsers.emplace_back(forest);
+
+	pool.run(sentences.size(), [&](size_t index, unsigned worker)
+	{
+		results[index] = parse_sentence(parsers[worker], sentences[index], cache);
+	});
+
+	return results;
+}
+
+std::vector<std::vector<Parser::Phrases>> parse_batch(
+	const std::vector<std::string_view>& sentences, unsigned threads, Forest forest, WordCache* cache)
+{
+	WorkPool pool(threads);
+	return parse_batch(sentences, pool, forest, cache);
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "parser.h"
+#include "pool.h"
+#include "word_cache.h"
+
+#include <string_view>
+
+// parse_word and the rules only read the lexicon after it has been loaded, 
+// which happens once, on first use, so sentences may be parsed on any number of threads 
+// as long as each thread has its own Parser
+
+// parses one sentence with a scratch parser, which is cleared first, 
+// words are looked up in cache if one is given
+std::vector<Parser::Phrases> parse_sentence(Parser& parser, std::string_view sentence, WordCache* cache = nullptr);
+
+// parses every sentence using one scratch parser per worker, results are in input order
+std::vector<std::vector<Parser::Phrases>> parse_batch(
+	const std::vector<std::string_view>& sentences, WorkPool& pool, Forest forest = Forest::expanded, WordCache* cache = nullptr);
+std::vector<std::vector<Parser::Phrases>> parse_batch(
+	const std::vector<std::string_view>& sentences, unsigned threads, Forest forest = Forest::expanded, WordCache* cache = nullptr);
@@ -0,0 +1,245 @@
+#include "bench.h"
+#include "../sample_sentences.h"
+#include "../simd.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iterator>
+#include <new>
+#include <ostream>
+#include <random>
+#include <sstream>
+
+namespace
+{
+	std::atomic<size_t> allocation_count{ 0 };
+	std::atomic<size_t> allocation_bytes{ 0 };
+
+	void* allocate(size_t size)
+	{
+		allocation_count.fetch_add(1, std::memory_order_relaxed);
+		allocation_bytes.fetch_add(size, std::memory_order_relaxed);
+		return std::malloc(size == 0 ? 1 : size);
+	}
+}
+
+void* operator new(size_t size)
+{
+	if (auto p = allocate(size))
+		return p;
+	throw std::bad_alloc();
+}
+void* operator new[](size_t size)
+{
+	if (auto p = allocate(size))
+		return p;
+	throw std::bad_alloc();
+}
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+namespace bench
+{
+	const std::vector<std::string_view>& readme_sentences()
+	{
+		static const std::vector<std::string_view> sentences(std::begin(sample_sentences), std::end(sample_sentences));
+		return sentences;
+	}
+
+	std::vector<std::string> joined_sentences(size_t count, size_t parts, unsigned seed)
+	{
+		const auto& sentences = readme_sentences();
+		std::mt19937 random(seed);
+		std::vector<std::string> result(count);
+		for (auto&& sentence : result)
+			for (size_t i = 0; i < parts; ++i)
+			{
+				if (i > 0)
+					sentence += " and ";
+				sentence += sentences[random() % sentences.size()];
+			}
+		return result;
+	}
+
+	std::vector<std::string> word_salad(size_t count, size_t length, unsigned seed)
+	{
+		std::vector<std::string_view> words;
+		for (auto sentence : readme_sentences())
+			for (size_t start = 0, end = 0; end != std::string_view::npos; start = end + 1)
+			{
+				end = sentence.find(' ', start);
+				words.push_back(sentence.substr(start, end - start));
+			}
+		std::mt19937 random(seed);
+		std::vector<std::string> result(count);
+		for (auto&& sentence : result)
+			for (size_t i = 0; i < length; ++i)
+			{
+				if (i > 0)
+					sentence += ' ';
+				sentence += words[random() % words.size()];
+			}
+		return result;
+	}
+
+	Allocations allocations()
+	{
+		return { allocation_count.load(std::memory_order_relaxed), allocation_bytes.load(std::memory_order_relaxed) };
+	}
+
+	Summary summarize(std::vector<double> samples)
+	{
+		Summary result;
+		result.samples = samples.size();
+		if (samples.empty())
+			return result;
+		std::sort(samples.begin(), samples.end());
+		const double n = double(samples.size());
+		for (auto s : samples)
+			result.mean += s / n;
+		result.min = samples.front();
+		result.median = samples.size() % 2 == 1 ? samples[samples.size() / 2] :
+			(samples[samples.size() / 2 - 1] + samples[samples.size() / 2]) / 2;
+		if (samples.size() < 2)
+			return result;
+		double squares = 0;
+		for (auto s : samples)
+			squares += (s - result.mean) * (s - result.mean);
+		result.stddev = std::sqrt(squares / (n - 1));
+
+		// two-sided 95% quantiles of Student's t for 1 to 30 degrees of freedom, the normal one after that
+		static constexpr double t95[] =
+		{
+			12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+			2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+			2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+		};
+		const size_t freedom = samples.size() - 1;
+		const double t = freedom <= std::size(t95) ? t95[freedom - 1] : 1.960;
+		result.ci95 = t * result.stddev / std::sqrt(n);
+		return result;
+	}
+
+	std::string build_description()
+	{
+		std::ostringstream result;
+#if defined(__clang__)
+		result << "clang " << __clang_major__ << '.' << __clang_minor__;
+#elif defined(__GNUC__)
+		result << "gcc " << __GNUC__ << '.' << __GNUC_MINOR__;
+#elif defined(_MSC_VER)
+		result << "msvc " << _MSC_VER;
+#else
+		result << "unknown compiler";
+#endif
+#if defined(GRAMMATICAL_AVX2)
+		result << ", avx2";
+#elif defined(GRAMMATICAL_SSE2)
+		result << ", sse2";
+#else
+		result << ", scalar";
+#endif
+#ifdef NDEBUG
+		result << ", no asserts";
+#else
+		result << ", asserts";
+#endif
+		return result.str();
+	}
+
+	void JsonWriter::_key(std::string_view key)
+	{
+		if (!_first.empty())
+		{
+			if (!_first.back())
+				_out << ',';
+			_first.back() = false;
+			_out << '\n' << std::string(_first.size() * 2, ' ');
+		}
+		if (!key.empty())
+		{
+			_string(key);
+			_out << ": ";
+		}
+	}
+
+	void JsonWriter::begin_object(std::string_view key)
+	{
+		_key(key);
+		_out << '{';
+		_first.push_back(true);
+	}
+	void JsonWriter::end_object()
+	{
+		_first.pop_back();
+		_out << '\n' << std::string(_first.size() * 2, ' ') << '}';
+		if (_first.empty())
+			_out << '\n';
+	}
+	void JsonWriter::begin_array(std::string_view key)
+	{
+		_key(key);
+		_out << '[';
+		_first.push_back(true);
+	}
+	void JsonWriter::end_array()
+	{
+		_first.pop_back();
+		_out << '\n' << std::string(_first.size() * 2, ' ') << ']';
+	}
+
+	void JsonWriter::_string(std::string_view s)
+	{
+		_out << '"';
+		for (const char ch : s)
+		{
+			switch (ch)
+			{
+			case '"': _out << "\\\""; break;
+			case '\\': _out << "\\\\"; break;
+			case '\n': _out << "\\n"; break;
+			case '\t': _out << "\\t"; break;
+			default:
+				if (static_cast<unsigned char>(ch) < 0x20)
+					_out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(ch) << std::dec << std::setfill(' ');
+				else
+					_out << ch;
+			}
+		}
+		_out << '"';
+	}
+
+	void JsonWriter::value(std::string_view key, std::string_view value)
+	{
+		_key(key);
+		_string(value);
+	}
+	void JsonWriter::value(std::string_view key, double value)
+	{
+		_key(key);
+		_out << std::setprecision(9) << value;
+	}
+	void JsonWriter::value(std::string_view key, size_t value)
+	{
+		_key(key);
+		_out << value;
+	}
+	void JsonWriter::value(std::string_view key, const Summary& summary)
+	{
+		begin_object(key);
+		value("samples", summary.samples);
+		value("mean", summary.mean);
+		value("stddev", summary.stddev);
+		value("ci95", summary.ci95);
+		value("min", summary.min);
+		value("median", summary.median);
+		end_object();
+	}
+}
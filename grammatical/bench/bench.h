@@ -0,0 +1,84 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// What the benchmarks have in common: the corpora, allocation counts, statistics over repeated runs and JSON output
+namespace bench
+{
+	// sample_sentences, which main.cpp shows and the README shows the parses of
+	const std::vector<std::string_view>& readme_sentences();
+
+	// count sentences that are each parts of the README's sentences joined by "and", the same for the same seed
+	std::vector<std::string> joined_sentences(size_t count, size_t parts, unsigned seed);
+	// count sentences of length words drawn from the README's sentences, for charts with little structure to find
+	std::vector<std::string> word_salad(size_t count, size_t length, unsigned seed);
+
+	// Allocations through operator new since the program started, by every thread. 
+	// Linking bench.cpp into a program replaces its operator new to count them
+	struct Allocations
+	{
+		size_t count = 0;
+		size_t bytes = 0;
+
+		Allocations operator-(const Allocations& b) const { return { count - b.count, bytes - b.bytes }; }
+		Allocations& operator+=(const Allocations& b) { count += b.count; bytes += b.bytes; return *this; }
+	};
+	Allocations allocations();
+
+	// keeps the compiler from leaving out work whose result is never used
+	template <class T>
+	inline void keep(const T& value)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		asm volatile("" : : "r"(&value) : "memory");
+#else
+		static const void* volatile sink;
+		sink = &value;
+#endif
+	}
+
+	using Clock = std::chrono::steady_clock;
+	inline double seconds_since(Clock::time_point start) { return std::chrono::duration<double>(Clock::now() - start).count(); }
+
+	// Repeated measurements of the same thing, with a 95% confidence interval for their mean from Student's t
+	struct Summary
+	{
+		size_t samples = 0;
+		double mean = 0;
+		double stddev = 0;
+		double ci95 = 0; // half the width of the interval
+		double min = 0;
+		double median = 0;
+	};
+	Summary summarize(std::vector<double> samples);
+
+	// the compiler, the vector instructions simd.h uses and whether asserts are on, to tell results from different builds apart
+	std::string build_description();
+
+	// Writes JSON as it is built, keys are given for members of objects and left out for elements of arrays
+	class JsonWriter
+	{
+		std::ostream& _out;
+		std::vector<bool> _first;
+		void _key(std::string_view key);
+		void _string(std::string_view s);
+	public:
+		explicit JsonWriter(std::ostream& out) : _out(out) { }
+
+		void begin_object(std::string_view key = {});
+		void end_object();
+		void begin_array(std::string_view key = {});
+		void end_array();
+
+		void value(std::string_view key, std::string_view value);
+		void value(std::string_view key, const char* value) { this->value(key, std::string_view(value)); }
+		void value(std::string_view key, double value);
+		void value(std::string_view key, size_t value);
+		void value(std::string_view key, const Summary& summary);
+	};
+}
@@ -0,0 +1,230 @@
+#include "bench.h"
+#include "../lexicon.h"
+#include "../parser.h"
+#include "../tokenizer.h"
+
+#include <array>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Runs fixed corpora through the stages of parsing, one stage at a time over the whole corpus, 
+// and reports the time and allocations of each stage over repeated runs:
+//   tokenize  TokenIterator over each sentence, splitting it into words
+//   analyse   Tokenizer::next over each sentence, which splits it again and looks every word up
+//   build     Parser::build, the chart
+//   results   Parser::results, the best covers copied out of the arenas. Parser::run is build and then results
+// The words are looked up without a cache, so analyse less tokenize is what parse_word costs
+namespace
+{
+	enum Stage { tokenize, analyse, build, results, stage_count };
+	constexpr const char* stage_names[stage_count] = { "tokenize", "analyse", "build", "results" };
+
+	struct Corpus
+	{
+		std::string name;
+		std::vector<std::string> sentences;
+	};
+
+	struct Pass
+	{
+		std::array<double, stage_count> seconds = {};
+		std::array<bench::Allocations, stage_count> allocations = {};
+		size_t tokens = 0;
+		size_t results = 0;
+	};
+
+	Pass run_pass(const Corpus& corpus, Parser& parser)
+	{
+		Pass pass;
+		const auto n = corpus.sentences.size();
+
+		auto start = bench::Clock::now();
+		auto allocated = bench::allocations();
+		const auto stop = [&](Stage stage)
+		{
+			pass.seconds[stage] += bench::seconds_since(start);
+			pass.allocations[stage] += bench::allocations() - allocated;
+		};
+
+		size_t tokens = 0;
+		for (size_t i = 0; i < n; ++i)
+			for (TokenIterator<std::string_view> it(corpus.sentences[i]); it; ++it)
+				tokens += !it.isWhitespace() && !it.isNewline();
+		stop(tokenize);
+		bench::keep(tokens);
+
+		start = bench::Clock::now();
+		allocated = bench::allocations();
+		std::vector<std::vector<Parser::Phrases>> words(n);
+		for (size_t i = 0; i < n; ++i)
+		{
+			Tokenizer<std::string_view> tokenizer{ std::string_view(corpus.sentences[i]) };
+			while (auto word = tokenizer.next())
+				words[i].emplace_back(std::move(*word));
+			pass.tokens += words[i].size();
+		}
+		stop(analyse);
+
+		for (size_t i = 0; i < n; ++i)
+		{
+			start = bench::Clock::now();
+			allocated = bench::allocations();
+			parser.clear();
+			for (auto&& word : words[i])
+				parser.push(word);
+			parser.build();
+			stop(build);
+
+			start = bench::Clock::now();
+			allocated = bench::allocations();
+			const auto result = parser.results();
+			stop(results);
+			pass.results += result.size();
+		}
+		return pass;
+	}
+
+	void usage(const char* program)
+	{
+		std::cerr << "usage: " << program << " [options]\n"
+			"  --repetitions n  timed runs of each corpus (default 10)\n"
+			"  --size n         sentences in each generated corpus (default 200)\n"
+			"  --corpus name    only run the corpus called name\n"
+			"  --packed         pack the chart\n"
+			"  --lexicon file   load a lexicon written by compile_lexicon\n"
+			"  --json file      also write the results to file as JSON\n";
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		size_t repetitions = 10;
+		size_t size = 200;
+		std::string only;
+		std::string json;
+		Forest forest = Forest::expanded;
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string arg = argv[i];
+			const auto value = [&]
+			{
+				if (i + 1 == argc)
+					throw std::runtime_error(arg + " needs a value");
+				return std::string(argv[++i]);
+			};
+			if (arg == "--repetitions")
+				repetitions = std::max<size_t>(std::stoul(value()), 1);
+			else if (arg == "--size")
+				size = std::stoul(value());
+			else if (arg == "--corpus")
+				only = value();
+			else if (arg == "--packed")
+				forest = Forest::packed;
+			else if (arg == "--lexicon")
+				set_compiled_lexicon(value());
+			else if (arg == "--json")
+				json = value();
+			else
+			{
+				usage(argv[0]);
+				return arg == "--help" || arg == "-h" ? 0 : 2;
+			}
+		}
+
+		std::vector<Corpus> corpora;
+		corpora.push_back({ "readme", { bench::readme_sentences().begin(), bench::readme_sentences().end() } });
+		corpora.push_back({ "joined-2", bench::joined_sentences(size, 2, 1) });
+		corpora.push_back({ "joined-4", bench::joined_sentences(size / 4, 4, 2) });
+		corpora.push_back({ "salad-6", bench::word_salad(size, 6, 3) });
+		if (!only.empty())
+		{
+			corpora.erase(std::remove_if(corpora.begin(), corpora.end(), [&](const Corpus& c) { return c.name != only; }), corpora.end());
+			if (corpora.empty())
+				throw std::runtime_error("there is no corpus called " + only);
+		}
+
+		std::ofstream json_file;
+		if (!json.empty())
+		{
+			json_file.open(json);
+			if (!json_file)
+				throw std::runtime_error("could not write " + json);
+		}
+		bench::JsonWriter out(json_file);
+		out.begin_object();
+		out.value("build", bench::build_description());
+		out.value("forest", forest == Forest::packed ? "packed" : "expanded");
+		out.value("repetitions", repetitions);
+		out.begin_array("corpora");
+
+		std::cout << "build: " << bench::build_description() << '\n' << std::fixed;
+		Parser parser(forest);
+		for (auto&& corpus : corpora)
+		{
+			// the first pass loads the lexicon and warms the caches, it isn't counted
+			const auto first = run_pass(corpus, parser);
+			std::array<std::vector<double>, stage_count> seconds;
+			std::vector<double> totals;
+			Pass last;
+			for (size_t r = 0; r < repetitions; ++r)
+			{
+				last = run_pass(corpus, parser);
+				// analyse tokenizes again, so the total leaves tokenize out
+				double total = 0;
+				for (int s = 0; s < stage_count; ++s)
+				{
+					seconds[s].push_back(last.seconds[s]);
+					if (s != tokenize)
+						total += last.seconds[s];
+				}
+				totals.push_back(total);
+			}
+			if (last.results != first.results)
+				throw std::runtime_error("the results of " + corpus.name + " changed between runs");
+			const auto total = bench::summarize(totals);
+
+			std::cout << '\n' << corpus.name << ": " << corpus.sentences.size() << " sentences, " << last.tokens << " tokens, "
+				<< last.results << " results, " << repetitions << " runs\n"
+				<< "  stage        mean ms    +-95% ms      min ms  allocs/run    KiB/run\n";
+			out.begin_object();
+			out.value("name", corpus.name);
+			out.value("sentences", corpus.sentences.size());
+			out.value("tokens", last.tokens);
+			out.value("results", last.results);
+			out.begin_object("stages");
+			for (int s = 0; s < stage_count; ++s)
+			{
+				const auto summary = bench::summarize(seconds[s]);
+				std::cout << "  " << std::left << std::setw(9) << stage_names[s] << std::right << std::setprecision(3)
+					<< std::setw(11) << summary.mean * 1e3 << std::setw(12) << summary.ci95 * 1e3 << std::setw(12) << summary.min * 1e3
+					<< std::setw(12) << last.allocations[s].count << std::setw(11) << std::setprecision(1) << last.allocations[s].bytes / 1024.0 << '\n';
+				out.begin_object(stage_names[s]);
+				out.value("seconds", summary);
+				out.value("allocations", last.allocations[s].count);
+				out.value("allocated_bytes", last.allocations[s].bytes);
+				out.end_object();
+			}
+			out.end_object();
+			out.value("seconds", total);
+			out.value("sentences_per_second", corpus.sentences.size() / total.mean);
+			out.value("tokens_per_second", last.tokens / total.mean);
+			out.end_object();
+			std::cout << std::setprecision(3) << "  total " << total.mean * 1e3 << " +- " << total.ci95 * 1e3 << " ms, "
+				<< std::setprecision(0) << corpus.sentences.size() / total.mean << " sentences/s, " << last.tokens / total.mean << " tokens/s\n";
+		}
+		out.end_array();
+		out.end_object();
+	}
+	catch (std::exception& e)
+	{
+		std::cerr << e.what() << '\n';
+		return 1;
+	}
+	return 0;
+}
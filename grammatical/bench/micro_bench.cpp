@@ -0,0 +1,502 @@
+#include "bench.h"
+#include "../arena.h"
+#include "../lexicon.h"
+#include "../rules.h"
+#include "../tokens.h"
+
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Times the building blocks the parser runs for every pair of neighbours, each on its own,
+// so a change to one of them can be measured without the noise of whole parses:
+//   tags     Tags::hasAll and hasAny on the tags of the README's words, with the masks the rules test
+//   lexeme   Lexeme::is between the lexemes of those words, and on deep and composite lexemes made from them
+//   bag      Bag::select, erase and extract on the arguments of the verbs, with the args predicates
+//   merge    both overloads of merge
+//   rule     each rule on a head and mod it builds something from
+// What merge and the rules build goes into an arena as in a parse, which is reset after every call, 
+// so their times include destroying it. The heads and mods they are given are built on the heap beforehand
+namespace
+{
+	struct Result
+	{
+		std::string name;
+		bench::Summary nanoseconds; // per operation
+		double allocations = 0; // per operation
+	};
+
+	class Bench
+	{
+		size_t _repetitions;
+		std::string _filter;
+	public:
+		std::vector<Result> results;
+
+		Bench(size_t repetitions, std::string filter) : _repetitions(repetitions), _filter(std::move(filter)) { }
+
+		// Doubles the calls to f until they take long enough to time, then times that many calls
+		// repetitions times. ops is the number of operations in one call
+		template <class F>
+		void measure(const std::string& name, size_t ops, F&& f)
+		{
+			if (name.find(_filter) == std::string::npos)
+				return;
+			size_t calls = 1;
+			for (;; calls *= 2)
+			{
+				const auto start = bench::Clock::now();
+				for (size_t i = 0; i < calls; ++i)
+					f();
+				if (bench::seconds_since(start) >= 0.01)
+					break;
+			}
+			std::vector<double> nanoseconds;
+			nanoseconds.reserve(_repetitions);
+			bench::Allocations allocated;
+			for (size_t r = 0; r < _repetitions; ++r)
+			{
+				const auto before = bench::allocations();
+				const auto start = bench::Clock::now();
+				for (size_t i = 0; i < calls; ++i)
+					f();
+				nanoseconds.push_back(bench::seconds_since(start) * 1e9 / double(calls * ops));
+				allocated += bench::allocations() - before;
+			}
+			results.push_back({ name, bench::summarize(nanoseconds), double(allocated.count) / double(calls * ops * _repetitions) });
+
+			const auto& result = results.back();
+			std::cout << "  " << std::left << std::setw(52) << name << std::right << std::setprecision(2)
+				<< std::setw(10) << result.nanoseconds.mean << std::setw(10) << result.nanoseconds.ci95
+				<< std::setw(10) << result.nanoseconds.min << std::setw(12) << result.allocations << '\n';
+		}
+	};
+
+	// a sink that only counts, what the rules emit is left in the arena
+	class CountingSink final : public RuleSink
+	{
+	public:
+		size_t count = 0;
+
+		void emit(std::shared_ptr<Phrase>) final { ++count; }
+	};
+
+	std::vector<Phrase::ptr> word(const std::string& orth)
+	{
+		auto analyses = parse_word(orth);
+		if (analyses.empty())
+			throw std::runtime_error(orth + " is not in the lexicon");
+		return analyses;
+	}
+
+	// the first head and mod the rule builds something from, built on the heap so they outlive the arena
+	template <class Rule>
+	std::pair<Phrase::ptr, Phrase::ptr> pair_for(const std::string& name, Rule rule,
+		const std::vector<Phrase::ptr>& heads, const std::vector<Phrase::ptr>& mods)
+	{
+		for (auto&& h : heads)
+			for (auto&& m : mods)
+			{
+				CountingSink out;
+				if constexpr (std::is_same_v<Rule, RawLeftRule>)
+					rule(m, head(h), out);
+				else
+					rule(head(h), m, out);
+				if (out.count > 0)
+					return { h, m };
+			}
+		throw std::runtime_error(name + " builds nothing from " + heads.front()->toString() + " and " + mods.front()->toString());
+	}
+
+	// what the rule builds from head and mod without errors
+	Phrase::ptr built(RawRightRule rule, const std::vector<Phrase::ptr>& heads, const std::vector<Phrase::ptr>& mods)
+	{
+		for (auto&& h : heads)
+			for (auto&& m : mods)
+			{
+				RuleBuffer out;
+				rule(head(h), m, out);
+				for (auto&& p : out.phrases)
+					if (p->errors.empty())
+						return p;
+			}
+		throw std::runtime_error("nothing to build " + heads.front()->toString() + " " + mods.front()->toString() + " from");
+	}
+
+	// the head and mod of the suffix the word ends with, which the head's right rule joined
+	std::pair<Phrase::ptr, Phrase::ptr> suffix_of(const std::string& orth, RawRightRule expected, const std::string& name)
+	{
+		for (auto&& analysis : word(orth))
+			if (auto w = phrase_cast<Word>(analysis.get()))
+				if (auto branch = phrase_cast<RightBranch>(w->morph().get()))
+					if (*branch->head->right_rule == expected)
+						return { branch->head, branch->mod };
+		throw std::runtime_error(orth + " is not joined by " + name);
+	}
+
+	void tags_benches(Bench& b, const std::vector<Phrase::ptr>& words)
+	{
+		std::vector<Tags> syns;
+		for (auto&& w : words)
+			syns.push_back(w->syn);
+		const std::vector<Tags> masks =
+		{
+			tags::sg3, tags::nonsg3, Tags{ Tag::pres, Tag::fin }, Tags{ Tag::nom, Tag::akk }, Tags{ Tag::fin, Tag::part }
+		};
+		const auto ops = syns.size() * masks.size();
+		b.measure("tags hasAll", ops, [&]
+		{
+			size_t n = 0;
+			for (auto&& syn : syns)
+				for (auto&& mask : masks)
+					n += syn.hasAll(mask);
+			bench::keep(n);
+		});
+		b.measure("tags hasAny", ops, [&]
+		{
+			size_t n = 0;
+			for (auto&& syn : syns)
+				for (auto&& mask : masks)
+					n += syn.hasAny(mask);
+			bench::keep(n);
+		});
+	}
+
+	void lexeme_benches(Bench& b, const std::vector<Phrase::ptr>& words)
+	{
+		std::vector<Lexeme::ptr> lexemes;
+		const auto add = [&](const Lexeme::ptr& l)
+		{
+			if (l && std::find(lexemes.begin(), lexemes.end(), l) == lexemes.end())
+				lexemes.push_back(l);
+		};
+		for (auto&& w : words)
+		{
+			add(w->sem);
+			for (auto&& arg : w->args)
+				add(arg.sem);
+		}
+		b.measure("lexeme is, lexicon", lexemes.size() * lexemes.size(), [&]
+		{
+			size_t n = 0;
+			for (auto&& a : lexemes)
+				for (auto&& p : lexemes)
+					n += a->is(p);
+			bench::keep(n);
+		});
+
+		// The lexicon is shallow and has no composites, the words only name one lexeme each. So the deep chain 
+		// and the composites are made over a copy of the lexemes above and what they are, and numbered with them 
+		// the way the lexicon numbers its own, which lets is() test their closures and signatures
+		std::vector<std::shared_ptr<Lexeme>> copies;
+		std::unordered_map<const Lexeme*, Lexeme::ptr> copied;
+		const std::function<Lexeme::ptr(const Lexeme::ptr&)> copy = [&](const Lexeme::ptr& l)
+		{
+			if (auto found = copied.find(l.get()); found != copied.end())
+				return found->second;
+			auto result = std::make_shared<Lexeme>(l->name);
+			for (auto&& e : l->sem)
+				result->become(copy(e));
+			copies.push_back(result);
+			return copied[l.get()] = result;
+		};
+		for (auto&& l : lexemes)
+			copy(l);
+		std::vector<Lexeme::ptr> named;
+		std::copy_if(copies.begin(), copies.end(), std::back_inserter(named), [](auto& l) { return !l->name.empty(); });
+
+		constexpr size_t depth = 8;
+		for (size_t i = 0; i < depth; ++i)
+		{
+			auto link = std::make_shared<Lexeme>("deep" + std::to_string(i));
+			link->become(i == 0 ? named.front() : copies.back());
+			copies.push_back(link);
+		}
+		const Lexeme::ptr deep = copies.back();
+
+		std::vector<Lexeme::ptr> composites;
+		for (size_t i = 0; i + 1 < named.size(); i += 2)
+		{
+			auto composite = std::make_shared<Lexeme>("");
+			composite->become(Lexeme::ptr_vector{ named[i], named[i + 1] });
+			composites.push_back(composite);
+			copies.push_back(composite);
+		}
+		number_lexemes(copies);
+		if (deep->number == Lexeme::unnumbered || std::any_of(composites.begin(), composites.end(), [](auto& l) { return !l->signature; }))
+			throw std::runtime_error("the copies of the lexemes were not numbered");
+
+		b.measure("lexeme is, deep", named.size(), [&]
+		{
+			size_t n = 0;
+			for (auto&& p : named)
+				n += deep->is(p);
+			bench::keep(n);
+		});
+		b.measure("lexeme is, composite", named.size() * composites.size(), [&]
+		{
+			size_t n = 0;
+			for (auto&& a : named)
+				for (auto&& p : composites)
+					n += a->is(p);
+			bench::keep(n);
+		});
+
+		// lexemes that are not in the lexicon have no numbers, so is() searches through them
+		std::vector<std::shared_ptr<Lexeme>> chain;
+		for (size_t i = 0; i < depth; ++i)
+		{
+			chain.push_back(std::make_shared<Lexeme>("deep" + std::to_string(i)));
+			chain.back()->become(i == 0 ? lexemes.front() : chain[i - 1]);
+		}
+		const Lexeme::ptr unnumbered_deep = chain.back();
+		b.measure("lexeme is, deep, unnumbered", lexemes.size(), [&]
+		{
+			size_t n = 0;
+			for (auto&& p : lexemes)
+				n += unnumbered_deep->is(p);
+			bench::keep(n);
+		});
+
+		std::vector<Lexeme::ptr> unnumbered_composites;
+		for (size_t i = 0; i + 1 < lexemes.size(); i += 2)
+		{
+			auto composite = std::make_shared<Lexeme>("");
+			composite->become(Lexeme::ptr_vector{ lexemes[i], lexemes[i + 1] });
+			unnumbered_composites.push_back(composite);
+		}
+		b.measure("lexeme is, composite, unnumbered", lexemes.size() * unnumbered_composites.size(), [&]
+		{
+			size_t n = 0;
+			for (auto&& a : lexemes)
+				for (auto&& p : unnumbered_composites)
+					n += a->is(p);
+			bench::keep(n);
+		});
+	}
+
+	void bag_benches(Bench& b, const std::vector<Phrase::ptr>& words)
+	{
+		std::vector<const Bag<Argument>*> bags;
+		std::vector<Phrase::ptr> nouns;
+		for (auto&& w : words)
+		{
+			if (std::any_of(w->args.begin(), w->args.end(), args::comp))
+				bags.push_back(&w->args);
+			if (w->syn.hasAny({ Tag::nom, Tag::akk }))
+				nouns.push_back(w);
+		}
+		if (bags.empty() || nouns.empty())
+			throw std::runtime_error("the README's words have no verbs with complements or no nouns");
+
+		b.measure("bag select comp", bags.size(), [&]
+		{
+			size_t n = 0;
+			for (auto&& bag : bags)
+				for (auto&& arg : bag->select(args::comp))
+					n += arg.mark == Mark::None;
+			bench::keep(n);
+		});
+		b.measure("bag select matching<comp>", bags.size() * nouns.size(), [&]
+		{
+			size_t n = 0;
+			for (auto&& bag : bags)
+				for (auto&& noun : nouns)
+					for (auto&& arg : bag->select(args::matching<Rel::comp>(Mark::None, noun)))
+						n += arg.mark == Mark::None;
+			bench::keep(n);
+		});
+		// erase and extract change the bag, so they are timed on copies, as merge copies the args of the head
+		b.measure("bag copy", bags.size(), [&]
+		{
+			for (auto&& bag : bags)
+			{
+				auto copy = *bag;
+				bench::keep(copy);
+			}
+		});
+		b.measure("bag copy, erase comp", bags.size(), [&]
+		{
+			for (auto&& bag : bags)
+			{
+				auto copy = *bag;
+				copy.erase(args::comp);
+				bench::keep(copy);
+			}
+		});
+		b.measure("bag copy, extract comp", bags.size(), [&]
+		{
+			for (auto&& bag : bags)
+			{
+				auto copy = *bag;
+				auto extracted = copy.extract(args::comp);
+				bench::keep(extracted);
+			}
+		});
+	}
+
+	void merge_benches(Bench& b, PhraseArena& arena)
+	{
+		const auto [book, the] = pair_for<RawLeftRule>("noun_det", noun_det, word("book"), word("the"));
+		b.measure("merge left", 1, [&, book = book, the = the]
+		{
+			PhraseArena::Use use(arena);
+			bench::keep(merge(the, ':', head(book), no_left, no_right));
+			arena.reset();
+		});
+		const auto [gave, me] = pair_for<RawRightRule>("verb_bicomp", verb_bicomp<head_comp<verb_adv, Tag::part, Tag::pres>>, word("gave"), word("me"));
+		b.measure("merge right", 1, [&, gave = gave, me = me]
+		{
+			PhraseArena::Use use(arena);
+			bench::keep(merge(head(gave), '*', me, gave->left_rule, gave->right_rule));
+			arena.reset();
+		});
+	}
+
+	void rule_benches(Bench& b, PhraseArena& arena)
+	{
+		const auto time = [&](const std::string& name, auto rule, const std::pair<Phrase::ptr, Phrase::ptr>& pair)
+		{
+			b.measure("rule " + name, 1, [&, rule, pair]
+			{
+				PhraseArena::Use use(arena);
+				CountingSink out;
+				if constexpr (std::is_same_v<decltype(rule), RawLeftRule>)
+					rule(pair.second, head(pair.first), out);
+				else
+					rule(head(pair.first), pair.second, out);
+				bench::keep(out.count);
+				arena.reset();
+			});
+		};
+		const auto left = [&](const std::string& name, RawLeftRule rule, const std::string& mod_orth, const std::string& head_orth)
+		{
+			time(name, rule, pair_for(name, rule, word(head_orth), word(mod_orth)));
+		};
+		const auto right = [&](const std::string& name, RawRightRule rule, const std::vector<Phrase::ptr>& heads, const std::vector<Phrase::ptr>& mods)
+		{
+			time(name, rule, pair_for(name, rule, heads, mods));
+		};
+
+		left("noun_det", noun_det, "the", "book");
+		left("ad_adad", ad_adad, "very", "expensive");
+		left("noun_adjective", noun_adjective, "useful", "information");
+		left("verb_spec", verb_spec, "they", "come");
+		left("be_lspec", be_lspec, "everybody", "is");
+
+		const std::vector<Phrase::ptr> of_food = { built(head_comp<no_right, Tag::part, Tag::pres>, word("of"), word("food")) };
+		right("head_prep", head_prep, word("lot"), of_food);
+		right("noun_rmod", noun_rmod, word("lot"), of_food);
+		right("verb_adv", verb_adv, word("finished"), word("soon"));
+		right("be_rspec", be_rspec, word("is"), word("everybody"));
+		right("aux_comp<part>", aux_comp<Tag::part>, word("been"), word("watching"));
+		right("aux_comp<fin, pres, pl>", aux_comp<Tag::fin, Tag::pres, Tag::pl>, word("do"), word("sell"));
+		right("aux_rspec<aux_comp<part, past>>", aux_rspec<aux_comp<Tag::part, Tag::past>>, word("had"), word("they"));
+		right("aux_rspec<verb_bicomp<...>>", aux_rspec<verb_bicomp<head_comp<verb_adv, Tag::dict>>>, word("will"), word("they"));
+		right("head_comp<no_right, part, pres>", head_comp<no_right, Tag::part, Tag::pres>, word("of"), word("food"));
+		right("head_comp<verb_adv, part, pres>", head_comp<verb_adv, Tag::part, Tag::pres>, word("bought"), word("furniture"));
+		right("verb_bicomp<head_comp<...>>", verb_bicomp<head_comp<verb_adv, Tag::part, Tag::pres>>, word("gave"), word("me"));
+
+		time("noun_suffix", RawRightRule(noun_suffix), suffix_of("books", noun_suffix, "noun_suffix"));
+		time("verb_suffix", RawRightRule(verb_suffix), suffix_of("working", verb_suffix, "verb_suffix"));
+	}
+
+	void usage(const char* program)
+	{
+		std::cerr << "usage: " << program << " [options]\n"
+			"  --repetitions n  timed runs of each benchmark (default 10)\n"
+			"  --filter text    only run the benchmarks whose names contain text\n"
+			"  --lexicon file   load a lexicon written by compile_lexicon\n"
+			"  --json file      also write the results to file as JSON\n";
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	try
+	{
+		size_t repetitions = 10;
+		std::string filter;
+		std::string json;
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string arg = argv[i];
+			const auto value = [&]
+			{
+				if (i + 1 == argc)
+					throw std::runtime_error(arg + " needs a value");
+				return std::string(argv[++i]);
+			};
+			if (arg == "--repetitions")
+				repetitions = std::max<size_t>(std::stoul(value()), 1);
+			else if (arg == "--filter")
+				filter = value();
+			else if (arg == "--lexicon")
+				set_compiled_lexicon(value());
+			else if (arg == "--json")
+				json = value();
+			else
+			{
+				usage(argv[0]);
+				return arg == "--help" || arg == "-h" ? 0 : 2;
+			}
+		}
+
+		std::ofstream json_file;
+		if (!json.empty())
+		{
+			json_file.open(json);
+			if (!json_file)
+				throw std::runtime_error("could not write " + json);
+		}
+
+		// every analysis of every word of the README's sentences
+		std::vector<Phrase::ptr> words;
+		for (auto&& sentence : bench::readme_sentences())
+			for (TokenIterator<std::string_view> it(sentence); it; ++it)
+				if (!it.isWhitespace() && !it.isNewline())
+					for (auto&& analysis : parse_word(it.folded()))
+						words.push_back(analysis);
+
+		std::cout << "build: " << bench::build_description() << '\n' << std::fixed
+			<< "  benchmark                                               ns/op    +-95%     min ns   allocs/op\n";
+		Bench b(repetitions, filter);
+		tags_benches(b, words);
+		lexeme_benches(b, words);
+		bag_benches(b, words);
+		PhraseArena arena;
+		merge_benches(b, arena);
+		rule_benches(b, arena);
+
+		bench::JsonWriter out(json_file);
+		out.begin_object();
+		out.value("build", bench::build_description());
+		out.value("repetitions", repetitions);
+		out.begin_array("benchmarks");
+		for (auto&& result : b.results)
+		{
+			out.begin_object();
+			out.value("name", result.name);
+			out.value("nanoseconds", result.nanoseconds);
+			out.value("allocations", result.allocations);
+			out.end_object();
+		}
+		out.end_array();
+		out.end_object();
+	}
+	catch (std::exception& e)
+	{
+		std::cerr << e.what() << '\n';
+		return 1;
+	}
+	return 0;
+}
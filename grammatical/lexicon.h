@@ -0,0 +1,20 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class Lexeme;
+
+// Makes parse_word load its lexicon from a file written by compile_lexicon instead of 
+// lexemes.txt and words.txt. Must be called before the first parse_word, an empty path means the text files
+void set_compiled_lexicon(std::string path);
+
+// Reads lexemes.txt and words.txt and writes them to path in the compiled format, 
+// throws std::runtime_error if path can't be written
+void compile_lexicon(const std::string& path);
+
+// Numbers the lexemes and sets their closures and signatures, so that is() tests bits between them, 
+// as the lexicon does with its own. A lexeme that is something not among them keeps no number, 
+// and is() searches its sem like before
+void number_lexemes(const std::vector<std::shared_ptr<Lexeme>>& lexemes);
@@ -1,6 +1,7 @@
 #include "phrase.h"
-#include "tokens.h"
 #include "parser.h"
+#include "batch.h"
+#include "sample_sentences.h"
 
 #include <iostream>
 
@@ -12,32 +13,6 @@ using std::vector;
 using std::optional;
 
 
-template <class Stream>
-class Tokenizer
-{
-	TokenIterator<Stream> _it;
-public:
-	template <class... Args>
-	Tokenizer(Args&&... args) : _it(forward<Args>(args)...) { }
-
-	optional<vector<Phrase::ptr>> next()
-	{
-		if (_it.isWhitespace()) ++_it;
-		if (!_it || _it.isNewline())
-			return std::nullopt;
-		auto result = parse_word(*_it);
-		if (result.empty())
-		{
-			const auto new_morph = make_shared<Morpheme>(*_it);
-			auto new_word = make_shared<Word>(new_morph->sem, new_morph);
-			new_word->errors.emplace_back("unknown word " + *_it);
-			result.emplace_back(move(new_word));
-		}
-		++_it;
-		return result;
-	}
-};
-
 #include <oui_window.h>
 #include <oui_text.h>
 
@@ -98,7 +73,7 @@ public:
 			if (!p->errors.empty())
 			{
 				oui::set(oui::colors::red);
-				for (auto&& error : p->errors)
+				for (auto&& error : describe_errors(*p))
 				{
 					max_y -= 24;
 					font.drawLine({ mid_x, max_y }, error, 24);
@@ -110,7 +85,7 @@ public:
 		};
 
 
-		if (auto lp = dynamic_cast<const LeftBranch*>(&p))
+		if (auto lp = phrase_cast<LeftBranch>(&p))
 		{
 			int max_depth = draw(*lp->mod);
 			const auto mid_x = add_space();
@@ -120,7 +95,7 @@ public:
 
 			return max_depth;
 		}
-		if (auto rp = dynamic_cast<const RightBranch*>(&p))
+		if (auto rp = phrase_cast<RightBranch>(&p))
 		{
 			int max_depth = draw(*rp->head);
 			const auto mid_x = add_space();
@@ -143,73 +118,24 @@ public:
 
 int main(int argc, char* argv[])
 {
-	const char* sentences[] =
-	{
-		"a wish",
-		"the book",
-		"have arrived",
-		"they will come",
-		"that English teacher",
-		"my latest idea",
-		"computers are very expensive",
-		"do you sell old books",
-		"we ate a lot of food",
-		"we bought some new furniture",
-		"that is useful information",
-		"he gave me some useful advice",
-		"they gave us a lot of information",
-		"let me give you some advice",
-		"let me give you a piece of advice",
-		"that is a useful piece of equipment",
-		//"we bought a few bits of furniture for the new apartment", // 'a few' is unsolved
-		//"how much luggage have you got", // question pronouns not yet supported
-		"she had six separate items of luggage",
-		"everybody is watching",
-		"is everybody watching",
-		"they had worked hard",
-		"had they worked hard",
-		"he has finished work",
-		"has he finished work",
-		"everybody had been working hard",
-		"had everybody been working hard",
-		"will they come",
-		"he might come",
-		"might he come",
-		"they will have arrived by now",
-		"will they have arrived by now",
-		"she would have been listening",
-		"would she have been listening",
-		"the work will be finished soon",
-		"will the work be finished soon",
-		"they might have been invited to the party",
-		"might they have been invited to the party",
-		"they eat garf",
-		"they give me books",
-		"he give me books"
-	};
-
 	auto window = oui::Window({ "grammatical", 600, 300, 4 });
 	auto font = oui::VectorFont(oui::resolve(oui::NativeFont::serif));
 
 	std::vector<std::vector<Phrase::ptr>> phrases;
 
-	for (auto sentence : sentences)
-	{
-		Tokenizer<std::istringstream> tokens(sentence);
-
-		Parser parse;
+	const std::vector<std::string_view> input(std::begin(sample_sentences), std::end(sample_sentences));
 
-		while (auto word = tokens.next())
-			parse.push(*word);
-
-		for (auto&& result : parse.run())
+	WordCache words;
+	for (auto&& results : parse_batch(input, std::thread::hardware_concurrency(), Forest::packed, &words))
+	{
+		for (auto&& result : results)
 		{
 			phrases.push_back(move(result));
 			//for (auto&& phrase : result)
 			//	cout << ' ' << phrase->toString();
 			//cout << '\n';
 			//for (auto&& phrase : result)
-			//	for (auto&& error : phrase->errors)
+			//	for (auto&& error : describe_errors(*phrase))
 			//		cout << "  * " << error << '\n';
 		}
 	}
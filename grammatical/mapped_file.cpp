@@ -0,0 +1,132 @@
+#include "mapped_file.h"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& path)
+{
+	_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (_file == INVALID_HANDLE_VALUE)
+	{
+		_file = nullptr;
+		throw std::runtime_error("could not open " + path);
+	}
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(_file, &size))
+	{
+		_close();
+		throw std::runtime_error("could not get the size of " + path);
+	}
+	_size = size_t(size.QuadPart);
+	if (_size == 0)
+		return;
+	_mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (_mapping)
+		_data = static_cast<const char*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!_data)
+	{
+		_close();
+		throw std::runtime_error("could not map " + path);
+	}
+}
+
+void MappedFile::_close()
+{
+	if (_data)
+		UnmapViewOfFile(_data);
+	if (_mapping)
+		CloseHandle(_mapping);
+	if (_file)
+		CloseHandle(_file);
+	_data = nullptr;
+	_mapping = nullptr;
+	_file = nullptr;
+	_size = 0;
+}
+
+MappedFile::MappedFile(MappedFile&& b) noexcept :
+	_data(std::exchange(b._data, nullptr)), _size(std::exchange(b._size, 0)),
+	_file(std::exchange(b._file, nullptr)), _mapping(std::exchange(b._mapping, nullptr)) { }
+
+MappedFile& MappedFile::operator=(MappedFile&& b) noexcept
+{
+	if (this != &b)
+	{
+		_close();
+		_data = std::exchange(b._data, nullptr);
+		_size = std::exchange(b._size, 0);
+		_file = std::exchange(b._file, nullptr);
+		_mapping = std::exchange(b._mapping, nullptr);
+	}
+	return *this;
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path)
+{
+	const int file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+		throw std::runtime_error("could not open " + path);
+	struct stat info;
+	if (fstat(file, &info) != 0)
+	{
+		close(file);
+		throw std::runtime_error("could not get the size of " + path);
+	}
+	_size = size_t(info.st_size);
+	if (_size > 0)
+	{
+		void* mapped = mmap(nullptr, _size, PROT_READ, MAP_SHARED, file, 0);
+		if (mapped == MAP_FAILED)
+		{
+			close(file);
+			_size = 0;
+			throw std::runtime_error("could not map " + path);
+		}
+		_data = static_cast<const char*>(mapped);
+	}
+	// the mapping stays valid without the descriptor
+	close(file);
+}
+
+void MappedFile::_close()
+{
+	if (_data)
+		munmap(const_cast<char*>(_data), _size);
+	_data = nullptr;
+	_size = 0;
+}
+
+MappedFile::MappedFile(MappedFile&& b) noexcept :
+	_data(std::exchange(b._data, nullptr)), _size(std::exchange(b._size, 0)) { }
+
+MappedFile& MappedFile::operator=(MappedFile&& b) noexcept
+{
+	if (this != &b)
+	{
+		_close();
+		_data = std::exchange(b._data, nullptr);
+		_size = std::exchange(b._size, 0);
+	}
+	return *this;
+}
+
+#endif
+
+MappedFile::~MappedFile()
+{
+	_close();
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// A file mapped read-only into memory. The pages come from the file cache,
+// so every process mapping the same file shares them
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	// throws std::runtime_error if the file can't be opened or mapped
+	explicit MappedFile(const std::string& path);
+	~MappedFile();
+
+	MappedFile(MappedFile&& b) noexcept;
+	MappedFile& operator=(MappedFile&& b) noexcept;
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const char* data() const { return _data; }
+	size_t size() const { return _size; }
+private:
+	const char* _data = nullptr;
+	size_t _size = 0;
+#ifdef _WIN32
+	void* _file = nullptr;
+	void* _mapping = nullptr;
+#endif
+
+	void _close();
+};
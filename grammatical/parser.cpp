@@ -1,39 +1,304 @@
 #include "parser.h"
+#include <algorithm>
 #include <cassert>
 
-void Parser::_match(const Phrase::ptr & a, const Phrase::ptr & b, int from, int to)
+static bool same_args(const Bag<Argument>& a, const Bag<Argument>& b)
 {
-	for (auto match : a->right_rule(head(a), b))
-		_agenda.emplace(move(match), from, to);
-	for (auto match : b->left_rule(a, head(b)))
-		_agenda.emplace(move(match), from, to);
+	if (a.size() != b.size())
+		return false;
+	auto itb = b.begin();
+	for (auto&& e : a)
+	{
+		if (e.rel != itb->rel || e.mark != itb->mark || e.syn != itb->syn || e.sem != itb->sem)
+			return false;
+		++itb;
+	}
+	return true;
 }
 
-void Parser::_generate_result(int length, Phrases && so_far, std::vector<Phrases>& result)
+static const Phrase& lexical_head(const Phrase& p)
 {
-	if (length == _positions.size())
-		result.emplace_back(move(so_far));
-	else
+	if (auto branch = phrase_cast<BinaryPhrase>(&p))
+		return lexical_head(*branch->head);
+	return p;
+}
+
+// true if a and b have the same text and are split the same way, what toString() would show, 
+// compared where it is instead of built up into strings
+static bool same_text(const Phrase& a, const Phrase& b)
+{
+	if (&a == &b)
+		return true;
+	if (a.kind() != b.kind())
+		return false;
+	if (auto ma = phrase_cast<Morpheme>(&a))
+		return ma->orth == static_cast<const Morpheme&>(b).orth;
+	if (auto wa = phrase_cast<Word>(&a))
+		return same_text(*wa->morph(), *static_cast<const Word&>(b).morph());
+	auto& ba = static_cast<const BinaryPhrase&>(a);
+	auto& bb = static_cast<const BinaryPhrase&>(b);
+	return ba.type == bb.type && same_text(*ba.head, *bb.head) && same_text(*ba.mod, *bb.mod);
+}
+
+// true if a and b look the same to every rule, so that anything built from b
+// can also be built from a
+static bool same_future(const Phrase& a, const Phrase& b)
+{
+	if (a.kind() != b.kind() || a.summary.branches != b.summary.branches ||
+		a.length != b.length || a.syn != b.syn || a.sem != b.sem ||
+		a.left_rule != b.left_rule || a.right_rule != b.right_rule ||
+		!same_args(a.args, b.args))
+		return false;
+	if (auto ba = phrase_cast<BinaryPhrase>(&a))
+	{
+		auto& bb = static_cast<const BinaryPhrase&>(b);
+		// head_prep looks at the preposition and its complement
+		return ba->type == bb.type &&
+			ba->mod->syn == bb.mod->syn && ba->mod->sem == bb.mod->sem &&
+			same_text(lexical_head(a), lexical_head(b));
+	}
+	return same_text(a, b);
+}
+
+bool Parser::_pack(const Item& item)
+{
+	for (auto&& e : _positions[item.from].begins_with)
+		if (same_future(*e, *item.phrase))
+		{
+			_alternatives[e.get()].emplace_back(item.phrase);
+			return true;
+		}
+	return false;
+}
+
+// passes what the rules build on to the parser's output, together with its span
+template <class Out>
+class SpanSink final : public RuleSink
+{
+	Out& _out;
+	int _from;
+	int _to;
+public:
+	SpanSink(Out& out, int from, int to) : _out(out), _from(from), _to(to) { }
+
+	void emit(std::shared_ptr<Phrase> p) final { _out(move(p), _from, _to); }
+};
+
+template <class Out>
+void Parser::_match(const Phrase::ptr & a, const Phrase::ptr & b, bool right, bool left, int from, int to, Out&& out) const
+{
+	SpanSink<std::remove_reference_t<Out>> sink{ out, from, to };
+	if (right)
+		a->right_rule(head(a), b, sink);
+	if (left)
+		b->left_rule(a, head(b), sink);
+}
+
+template <class Out>
+void Parser::_match(const Item& item, Neighbours neighbours, Out&& out) const
+{
+	if (item.from > 0)
+	{
+		auto& before = _positions[item.from - 1].ends_with;
+		for (size_t first = 0; first < neighbours.before; first += 64)
+			for (auto found = before.candidates(first, neighbours.before, item.category, item.left_accepts); found; found &= found - 1)
+			{
+				const size_t i = first + lowest_bit(found);
+				const bool right = (before.accepts[i] & item.category) != 0;
+				const bool left = (item.left_accepts & before.categories[i]) != 0;
+				_match(before[i], item.phrase, right, left, item.from - before[i]->length, item.to, out);
+			}
+	}
+	if (item.to + 1 < int(_positions.size()))
 	{
-		int longest = 0;
-		for (auto&& p : _positions[length].begins_with)
-			if (longest < p->length)
-				longest = p->length;
-		if (longest > 0)
-			for (auto&& p : _positions[length].begins_with) if (p->length == longest)
+		auto& after = _positions[item.to + 1].begins_with;
+		for (size_t first = 0; first < neighbours.after; first += 64)
+			for (auto found = after.candidates(first, neighbours.after, item.category, item.right_accepts); found; found &= found - 1)
 			{
-				auto copy = so_far;
-				copy.emplace_back(p);
-				_generate_result(length + longest, move(copy), result);
+				const size_t i = first + lowest_bit(found);
+				const bool right = (item.right_accepts & after.categories[i]) != 0;
+				const bool left = (after.accepts[i] & item.category) != 0;
+				_match(item.phrase, after[i], right, left, item.from, item.to + after[i]->length, out);
 			}
 	}
 }
 
+Parser::Covers::Covers(const Parser& parser) : _parser(parser), _rest(parser._positions.size() + 1)
+{
+	const int length = int(_rest.size()) - 1;
+	_rest[length] = Cost{ 0, 0 };
+	for (int i = length - 1; i >= 0; --i)
+	{
+		auto& best = _rest[i];
+		for (auto&& p : _parser._positions[i].begins_with)
+			if (auto& rest = _rest[i + p->length])
+			{
+				const Cost cost{ rest->first + 1, rest->second + p->errorCount() };
+				if (!best || cost < *best)
+					best = cost;
+			}
+	}
+	if (_rest[0])
+	{
+		_steps.push_back({ nullptr, 0, 0, { 0, 0 } });
+		_pending.push({ *_rest[0], 0, 0 });
+	}
+}
+
+std::optional<Parser::Covers::Cost> Parser::Covers::cost() const
+{
+	if (_pending.empty())
+		return std::nullopt;
+	return _pending.top().estimate;
+}
+
+// Every step is a cover of the sentence up to its end, the estimate adds the cheapest rest, 
+// so steps that end the sentence come out of _pending cheapest first
+void Parser::Covers::_expand(size_t step)
+{
+	const int from = _steps[step].end;
+	const auto so_far = _steps[step].cost;
+	// pushed last to first, so that the first is taken first among those as good as each other
+	const auto& column = _parser._positions[from].begins_with;
+	for (size_t i = column.size(); i-- > 0; )
+		if (auto& p = column[i]; auto& rest = _rest[from + p->length])
+		{
+			const Cost cost{ so_far.first + 1, so_far.second + p->errorCount() };
+			_pending.push({ { cost.first + rest->first, cost.second + rest->second }, _steps.size(), _steps.size() });
+			_steps.push_back({ &p, step, from + p->length, cost });
+		}
+}
+
+std::optional<Parser::Phrases> Parser::Covers::next()
+{
+	while (!_pending.empty())
+	{
+		const auto step = _pending.top().step;
+		_pending.pop();
+		if (_steps[step].end < int(_parser._positions.size()))
+		{
+			_expand(step);
+			continue;
+		}
+		Phrases result;
+		for (auto i = step; _steps[i].phrase; i = _steps[i].previous)
+			result.emplace_back(_parser._promote(*_steps[i].phrase));
+		std::reverse(result.begin(), result.end());
+		return result;
+	}
+	return std::nullopt;
+}
+
+// the parser keeps phrases pushed into it alive, and only hands borrowed pointers to the chart
+Phrase::ptr Parser::_pin(Phrase::ptr p)
+{
+	const auto raw = p.get();
+	auto& pin = _pinned[raw];
+	if (!pin.phrase)
+		pin.phrase = move(p);
+	++pin.items;
+	return borrowed(raw);
+}
+
+// lets go of an item an edit dropped, p is either pinned or was built in an arena
+void Parser::_release(const Phrase::ptr& p)
+{
+	if (auto pinned = _pinned.find(p.get()); pinned != _pinned.end())
+	{
+		if (--pinned->second.items == 0)
+			_pinned.erase(pinned);
+		return;
+	}
+	_dropped += p->kind() == Kind::left ? sizeof(LeftBranch) : sizeof(RightBranch);
+	if (auto promoted = _promoted.find(p.get()); promoted != _promoted.end())
+	{
+		_origins.erase(promoted->second.get());
+		_promoted.erase(promoted);
+	}
+}
+
+// Starts the parse over from the pinned items, so that the arenas can be reset. 
+// What is pinned is everything built from, the rest is built again by the next run
+void Parser::_rebuild()
+{
+	std::vector<Item> pinned;
+	const auto keep = [&](const Phrase::ptr& p, int from, int to)
+	{
+		if (_pinned.count(p.get()))
+			pinned.emplace_back(p, from, to);
+	};
+	for (int i = 0; i < int(_positions.size()); ++i)
+		for (auto&& p : _positions[i].begins_with)
+		{
+			keep(p, i, i + p->length - 1);
+			if (auto found = _alternatives.find(p.get()); found != _alternatives.end())
+				for (auto&& e : found->second)
+					keep(e, i, i + e->length - 1);
+		}
+	_agenda.revise([&](const Item& item)
+	{
+		keep(item.phrase, item.from, item.to);
+		return false;
+	});
+	std::stable_sort(pinned.begin(), pinned.end(), [](const Item& a, const Item& b) { return a.from < b.from; });
+
+	for (auto&& position : _positions)
+		position = {};
+	_top.clear();
+	_alternatives.clear();
+	_promoted.clear();
+	_origins.clear();
+	for (auto&& arena : _arenas)
+		arena.reset();
+	_dropped = 0;
+	for (auto&& item : pinned)
+		_agenda.emplace(std::move(item));
+}
+
+// Copies a phrase built in the arenas to the heap, sharing what it has in common with earlier copies. 
+// Everything in the chart that was not pushed was built by a rule, and rules only build branches
+Phrase::ptr Parser::_promote(const Phrase::ptr& p) const
+{
+	if (auto pinned = _pinned.find(p.get()); pinned != _pinned.end())
+		return pinned->second.phrase;
+	if (auto promoted = _promoted.find(p.get()); promoted != _promoted.end())
+		return promoted->second;
+
+	const auto& branch = static_cast<const BinaryPhrase&>(*p);
+	const auto copy_head = _promote(branch.head);
+	const auto copy_mod = _promote(branch.mod);
+	std::shared_ptr<BinaryPhrase> copy;
+	if (branch.kind() == Kind::left)
+		copy = std::make_shared<LeftBranch>(branch.syn, branch.sem, branch.type, head(copy_head), copy_mod, branch.left_rule, branch.right_rule);
+	else
+		copy = std::make_shared<RightBranch>(branch.syn, branch.sem, branch.type, head(copy_head), copy_mod, branch.left_rule, branch.right_rule);
+	copy->args = branch.args;
+	copy->errors = branch.errors;
+
+	_promoted.emplace(p.get(), copy);
+	_origins.emplace(copy.get(), p.get());
+	return copy;
+}
+
+size_t Parser::memory() const
+{
+	size_t result = 0;
+	for (auto&& arena : _arenas)
+		result += arena.bytes();
+	return result;
+}
+
+// what the budget counts, the phrases in the chart and on the agenda
+size_t Parser::_memory() const
+{
+	return memory() - _dropped;
+}
+
 void Parser::push(Phrase::ptr p)
 {
 	const int i = int(_positions.size());
 	_positions.emplace_back();
-	_agenda.emplace(move(p), i, i);
+	_agenda.emplace(_pin(move(p)), i, i);
 	_top.clear();
 }
 
@@ -43,7 +308,22 @@ void Parser::push(const Phrases & alternatives)
 	_positions.emplace_back();
 	_top.clear();
 	for (auto&& p : alternatives)
-		_agenda.emplace(p, i, i);
+		_agenda.emplace(_pin(p), i, i);
+}
+
+void Parser::clear()
+{
+	_positions.clear();
+	_top.clear();
+	_alternatives.clear();
+	_agenda.clear();
+	_truncated = false;
+	_pinned.clear();
+	_promoted.clear();
+	_origins.clear();
+	for (auto&& arena : _arenas)
+		arena.reset();
+	_dropped = 0;
 }
 
 void Parser::insert(Phrase::ptr p, int from, int to)
@@ -55,33 +335,250 @@ void Parser::insert(Phrase::ptr p, int from, int to)
 		_positions.resize(to + 1);
 		_top.clear();
 	}
-	_agenda.emplace(std::move(p), from, to);
+	_agenda.emplace(_pin(std::move(p)), from, to);
 }
 
-std::vector<Parser::Phrases> Parser::run()
+// removes every item that covers all positions from first to last
+void Parser::_drop(int first, int last)
 {
-	while (!_agenda.empty())
+	const auto covers = [=](int from, int to) { return from <= first && to >= last; };
+	for (int i = 0; i <= first; ++i)
 	{
-		if (!_top.empty() && _agenda.top().phrase->errorCount() > _top.front()->errorCount())
-			break;
-		auto item = _agenda.top(); _agenda.pop();
-		_positions[item.from].begins_with.emplace_back(item.phrase);
-		_positions[item.to].ends_with.emplace_back(item.phrase);
+		_positions[i].begins_with.erase_if([&](const Phrase::ptr& p)
+		{
+			if (!covers(i, i + p->length - 1))
+				return false;
+			if (auto found = _alternatives.find(p.get()); found != _alternatives.end())
+			{
+				for (auto&& e : found->second)
+					_release(e);
+				_alternatives.erase(found);
+			}
+			_release(p);
+			return true;
+		});
+	}
+	for (int i = last; i < int(_positions.size()); ++i)
+		_positions[i].ends_with.erase_if([&](const Phrase::ptr& p) { return covers(i - p->length + 1, i); });
+	_agenda.revise([&](const Item& item)
+	{
+		if (!covers(item.from, item.to))
+			return true;
+		_release(item.phrase);
+		return false;
+	});
+	if (_dropped > _rebuild_after && _dropped > _memory())
+		_rebuild();
+}
+
+// moves the queued items that start at or after from, the chart moves with _positions
+void Parser::_shift(int from, int offset)
+{
+	_agenda.revise([=](Item& item)
+	{
+		if (item.from >= from)
+		{
+			item.from += offset;
+			item.to += offset;
+		}
+		return true;
+	});
+}
+
+// after an edit the chart may already hold full parses, built before the edit as parts of a longer sentence
+void Parser::_find_top()
+{
+	_top.clear();
+	if (_positions.empty())
+		return;
+	for (auto&& p : _positions.front().begins_with) if (p->length == int(_positions.size()))
+	{
+		const auto errors = p->errorCount();
+		if (_top.empty() || errors < _top_errors)
+		{
+			_top.clear();
+			_top_errors = errors;
+		}
+		if (errors == _top_errors)
+			_top.emplace_back(p);
+	}
+}
+
+void Parser::replace(int i, const Phrases & alternatives)
+{
+	assert(i >= 0 && i < int(_positions.size()));
+	_drop(i, i);
+	_find_top();
+	for (auto&& p : alternatives)
+		_agenda.emplace(_pin(p), i, i);
+}
+
+void Parser::insert_at(int i, const Phrases & alternatives)
+{
+	assert(i >= 0 && i <= int(_positions.size()));
+	if (i > 0 && i < int(_positions.size()))
+		_drop(i - 1, i);
+	_shift(i, 1);
+	_positions.emplace(_positions.begin() + i);
+	_find_top();
+	for (auto&& p : alternatives)
+		_agenda.emplace(_pin(p), i, i);
+}
+
+void Parser::erase(int i)
+{
+	assert(i >= 0 && i < int(_positions.size()));
+	_drop(i, i);
+	_shift(i + 1, -1);
+	_positions.erase(_positions.begin() + i);
+	_find_top();
+	// the neighbours of the erased word are now next to each other
+	PhraseArena::Use use(_arenas.front());
+	if (i > 0 && i < int(_positions.size()))
+	{
+		auto& before = _positions[i - 1].ends_with;
+		auto& after = _positions[i].begins_with;
+		for (size_t x = 0; x < before.size(); ++x)
+			for (size_t first = 0; first < after.size(); first += 64)
+				for (auto found = after.candidates(first, after.size(), before.categories[x], before.accepts[x]); found; found &= found - 1)
+				{
+					const size_t y = first + lowest_bit(found);
+					const bool right = (before.accepts[x] & after.categories[y]) != 0;
+					const bool left = (after.accepts[y] & before.categories[x]) != 0;
+					_match(before[x], after[y], right, left, i - before[x]->length, i + after[y]->length - 1, 
+						[this](Phrase::ptr p, int from, int to) { _agenda.emplace(move(p), from, to); });
+				}
+	}
+}
 
-		if (item.phrase->length == int(_positions.size()))
-			_top.emplace_back(item.phrase);
+// adds item to the chart, unless it is packed into an item already there
+bool Parser::_add(Item& item)
+{
+	if (_forest == Forest::packed && _pack(item))
+		return false;
+	item.category = category(*item.phrase);
+	item.left_accepts = left_accepts(*item.phrase);
+	item.right_accepts = right_accepts(*item.phrase);
+	_positions[item.from].begins_with.push(item.phrase, item.category, item.left_accepts);
+	_positions[item.to].ends_with.push(item.phrase, item.category, item.right_accepts);
 
-		if (item.from > 0)
-			for (auto&& e : _positions[item.from - 1].ends_with)
-				_match(e, item.phrase, item.from - e->length, item.to);
-		if (item.to + 1 < int(_positions.size()))
-			for (auto&& e : _positions[item.to + 1].begins_with)
-				_match(item.phrase, e, item.from, item.to + e->length);
+	if (item.phrase->length == int(_positions.size()))
+	{
+		if (_top.empty() || item.errors < _top_errors)
+		{
+			_top.clear();
+			_top_errors = item.errors;
+		}
+		_top.emplace_back(item.phrase);
 	}
+	return true;
+}
+
+Parser::Neighbours Parser::_neighbours(const Item& item) const
+{
+	return 
+	{
+		item.from > 0 ? _positions[item.from - 1].ends_with.size() : 0,
+		item.to + 1 < int(_positions.size()) ? _positions[item.to + 1].begins_with.size() : 0
+	};
+}
 
+std::vector<Parser::Phrases> Parser::results(size_t k) const
+{
 	std::vector<Phrases> result;
 
-	_generate_result(0, {}, result);
+	auto all = covers();
+	for (const auto best = all.cost(); best && all.cost() == best && result.size() < k; )
+		result.emplace_back(*all.next());
+
+	return result;
+}
+
+std::vector<Parser::Phrases> Parser::run(const Budget& budget, size_t k)
+{
+	build(budget);
+	return results(k);
+}
+
+void Parser::build(const Budget& budget)
+{
+	const auto queue = [this](Phrase::ptr p, int from, int to) { _agenda.emplace(move(p), from, to); };
+	PhraseArena::Use use(_arenas.front());
+	_truncated = false;
+	for (size_t pops = 0; !_agenda.empty(); ++pops)
+	{
+		if (!_top.empty() && _agenda.errors() > _top_errors)
+			break;
+		if (budget.exceeded(pops, _memory()))
+		{
+			_truncated = true;
+			break;
+		}
+		auto item = _agenda.pop();
+		if (_add(item))
+			_match(item, _neighbours(item), queue);
+	}
+}
+
+std::vector<Parser::Phrases> Parser::run(WorkPool& pool, const Budget& budget, size_t k)
+{
+	std::vector<std::pair<Item, Neighbours>> round;
+	std::vector<std::vector<Item>> found;
+	while (_arenas.size() < pool.size())
+		_arenas.emplace_back();
+	PhraseArena::Use use(_arenas.front());
+	size_t pops = 0;
+	_truncated = false;
+	while (!_agenda.empty())
+	{
+		if (!_top.empty() && _agenda.errors() > _top_errors)
+			break;
+		if (budget.exceeded(pops, _memory()))
+		{
+			_truncated = true;
+			break;
+		}
+		// Items with the same error count only depend on each other through the chart. 
+		// They are added in agenda order, and each is matched against what was in the chart before it, 
+		// so the agenda ends up exactly as after run()
+		round.clear();
+		for (size_t n = std::min(_agenda.front_size(), budget.max_pops - pops); n > 0; --n, ++pops)
+		{
+			auto item = _agenda.pop();
+			if (_add(item))
+			{
+				const auto neighbours = _neighbours(item);
+				round.emplace_back(std::move(item), neighbours);
+			}
+		}
+		found.resize(round.size());
+		const auto match = [&](size_t i, unsigned worker)
+		{
+			PhraseArena::Use use(_arenas[worker]);
+			found[i].clear();
+			_match(round[i].first, round[i].second, 
+				[&out = found[i]](Phrase::ptr p, int from, int to) { out.emplace_back(move(p), from, to); });
+		};
+		// waking the pool costs more than matching a few items
+		if (round.size() < 2 * pool.size())
+			for (size_t i = 0; i < round.size(); ++i)
+				match(i, 0);
+		else
+			pool.run(round.size(), match);
 
+		for (size_t i = 0; i < round.size(); ++i)
+			for (auto&& item : found[i])
+				_agenda.emplace(std::move(item));
+	}
+	return results(k);
+}
+
+Parser::Phrases Parser::alternatives(const Phrase& p) const
+{
+	Phrases result;
+	const auto origin = _origins.find(&p);
+	if (auto found = _alternatives.find(origin == _origins.end() ? &p : origin->second); found != _alternatives.end())
+		for (auto&& e : found->second)
+			result.emplace_back(_promote(e));
 	return result;
 }
@@ -1,47 +1,326 @@
 #pragma once
 
 #include "phrase.h"
+#include "arena.h"
+#include "pool.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <optional>
 #include <queue>
+#include <tuple>
+#include <unordered_map>
+
+// expanded keeps every derivation as its own chart item, packed merges items 
+// that span the same words and look the same to every rule into one node
+enum class Forest : char { expanded, packed };
+
+// Limits for one call to Parser::run. When one is reached the parser stops, 
+// returns the best it has so far and keeps the rest of the agenda for the next run
+struct Budget
+{
+	std::optional<std::chrono::steady_clock::time_point> deadline;
+	size_t max_pops = std::numeric_limits<size_t>::max();
+	size_t max_memory = std::numeric_limits<size_t>::max(); // bytes of the phrases built that are still in the chart
+
+	bool exceeded(size_t pops, size_t memory) const
+	{
+		return pops >= max_pops || memory >= max_memory || 
+			(deadline && std::chrono::steady_clock::now() >= *deadline);
+	}
+};
 
 class Parser
 {
+public:
 	using Phrases = std::vector<Phrase::ptr>;
+private:
+	// Phrases that start or end at a position, with the masks from category() and left_accepts() or 
+	// right_accepts() in arrays of their own, so neighbours no rule can use are skipped without touching the phrases
+	struct Column
+	{
+		Phrases phrases;
+		std::vector<unsigned> categories;
+		std::vector<unsigned> accepts; // what the rule of each phrase towards the position accepts
+
+		size_t size() const { return phrases.size(); }
+		Phrases::const_iterator begin() const { return phrases.begin(); }
+		Phrases::const_iterator end() const { return phrases.end(); }
+		const Phrase::ptr& operator[](size_t i) const { return phrases[i]; }
+
+		// Bit j is set if the phrase at first + j, below end, may match a phrase of the given category 
+		// whose rule towards this column accepts the given mask. At most 64 phrases are tested at once
+		uint64_t candidates(size_t first, size_t end, unsigned category, unsigned accepts) const
+		{
+			return matching_masks(categories.data() + first, this->accepts.data() + first, 
+				std::min<size_t>(64, end - first), category, accepts);
+		}
+
+		void push(Phrase::ptr p, unsigned category, unsigned accepts)
+		{
+			phrases.emplace_back(std::move(p));
+			categories.emplace_back(category);
+			this->accepts.emplace_back(accepts);
+		}
+
+		// removes the phrases for which f returns true, keeping the order of the rest
+		template <class F>
+		void erase_if(F&& f)
+		{
+			size_t kept = 0;
+			for (size_t i = 0; i < phrases.size(); ++i) if (!f(phrases[i]))
+			{
+				phrases[kept] = std::move(phrases[i]);
+				categories[kept] = categories[i];
+				accepts[kept] = accepts[i];
+				++kept;
+			}
+			phrases.resize(kept);
+			categories.resize(kept);
+			accepts.resize(kept);
+		}
+	};
 	struct Position
 	{
-		Phrases begins_with;
-		Phrases ends_with;
+		Column begins_with; // accepts holds left_accepts()
+		Column ends_with; // accepts holds right_accepts()
 	};
 	std::vector<Position> _positions;
 	Phrases _top;
 
+	bool _truncated = false;
+
+	// Phrases built by rules live in the arenas, one for each worker of a parallel run. 
+	// The chart only holds borrowed pointers, to those and to the phrases pushed, which are pinned 
+	// once for every item they are in. Results are copied out of the arenas before they are handed out
+	std::vector<PhraseArena> _arenas = std::vector<PhraseArena>(1);
+	struct Pin
+	{
+		Phrase::ptr phrase;
+		size_t items = 0;
+	};
+	std::unordered_map<const Phrase*, Pin> _pinned;
+	// bytes in the arenas of phrases that edits dropped, given back when the chart is rebuilt
+	size_t _dropped = 0;
+	static constexpr size_t _rebuild_after = 1 << 20;
+	mutable std::unordered_map<const Phrase*, Phrase::ptr> _promoted;
+	mutable std::unordered_map<const Phrase*, const Phrase*> _origins;
+
+	Forest _forest = Forest::expanded;
+	std::unordered_map<const Phrase*, Phrases> _alternatives;
+
 	struct Item
 	{
 		Phrase::ptr phrase;
 		int from;
 		int to;
+		size_t errors;
+		// masks of the phrase, set when it is added to the chart
+		unsigned category = 0;
+		unsigned left_accepts = 0;
+		unsigned right_accepts = 0;
 
-		Item(Phrase::ptr phrase, int from, int to) : phrase(move(phrase)), from(from), to(to) { }
+		Item(Phrase::ptr phrase, int from, int to) : 
+			phrase(move(phrase)), from(from), to(to), errors(this->phrase->errorCount()) { }
 	};
-	struct ErrorOrder
+	// items bucketed by error count, first-in first-out within each bucket
+	class Agenda
 	{
-		bool operator()(const Item& a, const Item& b)
+		struct Bucket
+		{
+			std::vector<Item> items;
+			size_t next = 0;
+
+			bool empty() const { return next == items.size(); }
+		};
+		std::vector<Bucket> _buckets;
+		size_t _min = 0;
+		size_t _size = 0;
+	public:
+		template <class... Args>
+		void emplace(Args&&... args)
+		{
+			Item item(std::forward<Args>(args)...);
+			if (_buckets.size() <= item.errors)
+				_buckets.resize(item.errors + 1);
+			if (_size == 0 || item.errors < _min)
+				_min = item.errors;
+			_buckets[item.errors].items.emplace_back(std::move(item));
+			++_size;
+		}
+
+		bool empty() const { return _size == 0; }
+
+		// number of items sharing the lowest error count
+		size_t front_size() const { return empty() ? 0 : _buckets[_min].items.size() - _buckets[_min].next; }
+
+		void clear()
+		{
+			for (auto&& bucket : _buckets)
+			{
+				bucket.items.clear();
+				bucket.next = 0;
+			}
+			_min = 0;
+			_size = 0;
+		}
+
+		// error count of the next item to be popped
+		size_t errors() const { assert(!empty()); return _min; }
+
+		Item pop()
+		{
+			assert(!empty());
+			auto& bucket = _buckets[_min];
+			Item item = std::move(bucket.items[bucket.next++]);
+			if (bucket.empty())
+			{
+				bucket.items.clear();
+				bucket.next = 0;
+			}
+			if (--_size > 0)
+				while (_buckets[_min].empty())
+					++_min;
+			return item;
+		}
+
+		// keeps the items for which f returns true, f may also update them
+		template <class F>
+		void revise(F&& f)
 		{
-			return a.phrase->errorCount() > b.phrase->errorCount();
+			_size = 0;
+			for (size_t errors = 0; errors < _buckets.size(); ++errors)
+			{
+				auto& bucket = _buckets[errors];
+				auto kept = bucket.items.begin();
+				for (auto it = kept + bucket.next; it != bucket.items.end(); ++it)
+					if (f(*it))
+						*kept++ = std::move(*it);
+				bucket.items.erase(kept, bucket.items.end());
+				bucket.next = 0;
+				if (!bucket.empty() && _size == 0)
+					_min = errors;
+				_size += bucket.items.size();
+			}
 		}
 	};
-	std::priority_queue<Item, std::vector<Item>, ErrorOrder> _agenda;
+	Agenda _agenda;
+	size_t _top_errors = 0;
 
-	void _match(const Phrase::ptr& a, const Phrase::ptr& b, int from, int to);
+	bool _pack(const Item& item);
 
-	void _generate_result(int length, Phrases&& so_far, std::vector<Phrases>& result);
+	void _drop(int first, int last);
+	void _shift(int from, int offset);
+	void _find_top();
+
+	// how many items were next to an item in the chart when it was added
+	struct Neighbours
+	{
+		size_t before;
+		size_t after;
+	};
+
+	bool _add(Item& item);
+	Neighbours _neighbours(const Item& item) const;
+
+	// right and left tell which of a's right rule and b's left rule to apply
+	template <class Out>
+	void _match(const Phrase::ptr& a, const Phrase::ptr& b, bool right, bool left, int from, int to, Out&& out) const;
+	template <class Out>
+	void _match(const Item& item, Neighbours neighbours, Out&& out) const;
+
+	Phrase::ptr _pin(Phrase::ptr p);
+	void _release(const Phrase::ptr& p);
+	void _rebuild();
+	Phrase::ptr _promote(const Phrase::ptr& p) const;
+	size_t _memory() const;
 public:
+	// Covers of the whole sentence by chart items, best first, built one at a time. 
+	// A cover is better if it has fewer phrases, or as many phrases and fewer errors
+	class Covers
+	{
+	public:
+		using Cost = std::pair<size_t, size_t>; // phrases, errors
+
+		explicit Covers(const Parser& parser);
+
+		// cost of the next cover, if any
+		std::optional<Cost> cost() const;
+
+		std::optional<Phrases> next();
+	private:
+		struct Step
+		{
+			const Phrase::ptr* phrase;
+			size_t previous;
+			int end;
+			Cost cost;
+		};
+		struct Pending
+		{
+			Cost estimate;
+			size_t order;
+			size_t step;
+
+			// cheapest first, and the latest of those as good as each other, so that a cover 
+			// is finished before the next is started
+			bool operator<(const Pending& b) const { return std::tie(b.estimate, order) < std::tie(estimate, b.order); }
+		};
+		const Parser& _parser;
+		// cheapest way to cover the sentence from each position to its end
+		std::vector<std::optional<Cost>> _rest;
+		std::vector<Step> _steps;
+		std::priority_queue<Pending> _pending;
+
+		void _expand(size_t step);
+	};
+
+	Parser() = default;
+	explicit Parser(Forest forest) : _forest(forest) { }
 
 	void push(Phrase::ptr p);
 	void push(const Phrases& alternatives);
 
 	void insert(Phrase::ptr p, int from, int to);
 
+	// edits keep every item that does not span the edited position, 
+	// the next run only builds what goes across it. Once what they dropped takes 
+	// more memory than the chart, the chart is built again from what was pushed
+	void replace(int i, const Phrases& alternatives);
+	void insert_at(int i, const Phrases& alternatives);
+	void erase(int i);
+
 	size_t length() const { return _positions.size(); }
 
-	std::vector<Phrases> run();
+	// empties the parser for the next sentence, keeping its memory
+	void clear();
+
+	// how many covers results() returns unless told otherwise, an ambiguous sentence can have exponentially many
+	static constexpr size_t default_covers = 16;
+
+	// build() and then results()
+	std::vector<Phrases> run(const Budget& budget = {}, size_t k = default_covers);
+	// same result as run(), items with the same error count are matched concurrently
+	// and the budget is only checked between those rounds
+	std::vector<Phrases> run(WorkPool& pool, const Budget& budget = {}, size_t k = default_covers);
+
+	// matches items from the agenda until no better result can come or the budget runs out
+	void build(const Budget& budget = {});
+	// the first k covers from covers() that are as good as the best one, copied out of the arenas
+	std::vector<Phrases> results(size_t k = default_covers) const;
+
+	// bytes the arenas hold, for phrases in the chart and for those edits dropped and have not given back yet
+	size_t memory() const;
+
+	// true if the last run stopped because it ran out of budget
+	bool truncated() const { return _truncated; }
+
+	// covers of the chart as it is, valid until the parser is changed
+	Covers covers() const { return Covers(*this); }
+
+	// other derivations packed into p, which must come from a result of this parser, 
+	// empty unless the forest is packed
+	Phrases alternatives(const Phrase& p) const;
 };
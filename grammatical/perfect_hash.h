@@ -0,0 +1,81 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+// A fixed set of string keys, hashed at compile time with a seed that gives every key a slot of its own.
+// A lookup is one hash and at most one key comparison, and nothing is allocated
+template <class T, size_t N>
+class PerfectHash
+{
+public:
+	using Entry = std::pair<std::string_view, T>;
+
+	constexpr PerfectHash(const Entry (&entries)[N]) : PerfectHash(entries, std::make_index_sequence<N>()) { }
+
+	constexpr const T* find(std::string_view key) const
+	{
+		const auto i = _slots[_slot(key, _seed)];
+		return i < N && _entries[i].first == key ? &_entries[i].second : nullptr;
+	}
+
+	static constexpr size_t size() { return N; }
+
+private:
+	// four slots or more for each key keeps the search for a seed short
+	static constexpr size_t _slot_count()
+	{
+		size_t n = 1;
+		while (n < 4 * N)
+			n *= 2;
+		return n;
+	}
+
+	std::array<Entry, N> _entries;
+	std::array<size_t, _slot_count()> _slots{};
+	uint64_t _seed = 0;
+
+	// FNV-1a, starting from the seed
+	static constexpr size_t _slot(std::string_view key, uint64_t seed)
+	{
+		uint64_t h = 0xcbf29ce484222325 ^ seed;
+		for (const char c : key)
+		{
+			h ^= static_cast<unsigned char>(c);
+			h *= 0x100000001b3;
+		}
+		return static_cast<size_t>(h ^ (h >> 29)) & (_slot_count() - 1);
+	}
+
+	template <size_t... I>
+	constexpr PerfectHash(const Entry (&entries)[N], std::index_sequence<I...>) : _entries{ { entries[I]... } }
+	{
+		for (; !_place(); ++_seed)
+			if (_seed == 0xffff)
+				throw std::logic_error("no seed places every key in a slot of its own");
+	}
+
+	constexpr bool _place()
+	{
+		for (auto& slot : _slots)
+			slot = N;
+		for (size_t i = 0; i < N; ++i)
+		{
+			auto& slot = _slots[_slot(_entries[i].first, _seed)];
+			if (slot != N)
+			{
+				if (_entries[slot].first == _entries[i].first)
+					throw std::logic_error("duplicate key");
+				return false;
+			}
+			slot = i;
+		}
+		return true;
+	}
+};
+
+template <class T, size_t N>
+constexpr PerfectHash<T, N> make_perfect_hash(const std::pair<std::string_view, T> (&entries)[N]) { return { entries }; }
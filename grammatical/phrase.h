@@ -1,10 +1,13 @@
 #pragma once
 
 #include "ranged.h"
+#include "perfect_hash.h"
 
 #include <cassert>
+#include <cstdint>
 #include <memory>
 #include <map>
+#include <optional>
 #include <unordered_map>
 #include <vector>
 #include <string_view>
@@ -176,8 +179,14 @@ public:
 
 	constexpr Tags select(Tags b) const { return { _flags & b._flags }; }
 
+	constexpr bool operator==(Tags b) const { return _flags == b._flags; }
+	constexpr bool operator!=(Tags b) const { return _flags != b._flags; }
+
 	constexpr explicit operator bool() const { return _flags != 0; }
 
+	constexpr unsigned bits() const { return _flags; }
+	static constexpr Tags fromBits(unsigned bits) { return Tags(bits); }
+
 	friend std::string to_string(Tags tags);
 };
 
@@ -214,17 +223,16 @@ enum class Mark : char { None, By, Of, To, For };
 
 inline std::optional<Mark> mark(std::string_view n)
 {
-	using namespace std::string_view_literals;
-	static const std::unordered_map<std::string_view, Mark> lookup =
+	static constexpr auto lookup = make_perfect_hash<Mark>(
 	{
-		{ "none"sv, Mark::None },
-		{ "by"sv, Mark::By },
-		{ "of"sv, Mark::Of },
-		{ "to"sv, Mark::To },
-		{ "for"sv, Mark::For }
-	};
-	if (auto found = lookup.find(n); found != lookup.end())
-		return found->second;
+		{ "none", Mark::None },
+		{ "by", Mark::By },
+		{ "of", Mark::Of },
+		{ "to", Mark::To },
+		{ "for", Mark::For }
+	});
+	if (auto found = lookup.find(n))
+		return *found;
 	return {};
 }
 
@@ -249,27 +257,44 @@ public:
 	constexpr bool operator!=(const NonNull& other) const { return _ptr != other._ptr; }
 };
 
-using RuleOutput = std::vector<std::shared_ptr<Phrase>>;
-using RawLeftRule = RuleOutput(*)(const Mod&, const Head&);
-using RawRightRule = RuleOutput(*)(const Head&, const Mod&);
+// Rules hand what they build to a sink rather than returning a container, 
+// so matching two phrases allocates nothing but the phrases themselves
+class RuleSink
+{
+public:
+	virtual void emit(std::shared_ptr<Phrase> p) = 0;
+protected:
+	~RuleSink() = default;
+};
+// a sink that just collects the phrases, for callers that want them in a list
+class RuleBuffer final : public RuleSink
+{
+public:
+	std::vector<std::shared_ptr<Phrase>> phrases;
+
+	void emit(std::shared_ptr<Phrase> p) final { phrases.emplace_back(std::move(p)); }
+};
+
+using RawLeftRule = void(*)(const Mod&, const Head&, RuleSink&);
+using RawRightRule = void(*)(const Head&, const Mod&, RuleSink&);
 class LeftRule : public NonNull<RawLeftRule>
 {
 public:
 	using NonNull<RawLeftRule>::NonNull;
 
-	RuleOutput operator()(const Mod& mod, const Head& head) const { return operator*()(mod, head); }
+	void operator()(const Mod& mod, const Head& head, RuleSink& out) const { operator*()(mod, head, out); }
 };
 class RightRule : public NonNull<RawRightRule>
 {
 public:
 	using NonNull<RawRightRule>::NonNull;
 
-	RuleOutput operator()(const Head& head, const Mod& mod) const { return operator*()(head, mod); }
+	void operator()(const Head& head, const Mod& mod, RuleSink& out) const { operator*()(head, mod, out); }
 };
 
 
-inline RuleOutput no_left(const Mod&, const Head&) { return {}; }
-inline RuleOutput no_right(const Head&, const Mod&) { return {}; }
+inline void no_left(const Mod&, const Head&, RuleSink&) { }
+inline void no_right(const Head&, const Mod&, RuleSink&) { }
 
 class Lexeme;
 
@@ -328,6 +353,14 @@ public:
 
 	Bag<Argument> args;
 
+	// Set by number_lexemes, so is() can test bits instead of searching sem. 
+	// closure has the number of every lexeme this is through sem, itself included. 
+	// A composite lexeme whose parts are all named also has their numbers in signature
+	static constexpr size_t unnumbered = size_t(-1);
+	size_t number = unnumbered;
+	std::vector<uint64_t> closure;
+	std::optional<std::vector<uint64_t>> signature;
+
 	Lexeme(string name) : name(move(name)) { }
 
 	template <class T>
@@ -356,6 +389,21 @@ public:
 	{
 		if (this == p.get())
 			return true;
+		if (number != unnumbered && p->number != unnumbered)
+		{
+			if (closure[p->number / 64] & (uint64_t(1) << p->number % 64))
+				return true;
+			if (!p->name.empty())
+				return false;
+			if (p->signature)
+			{
+				for (size_t i = 0; i < closure.size(); ++i)
+					if ((*p->signature)[i] & ~closure[i])
+						return false;
+				return true;
+			}
+			return is(p->sem);
+		}
 		// check if any part of this is p
 		for (auto&& e : sem)
 			if (e->is(p))
@@ -388,6 +436,47 @@ public:
 	}
 };
 
+enum class Kind : char { morpheme, word, left, right };
+
+// What a rule found wrong with a phrase. Only the code is kept, the message is written by describe() 
+// from the phrase the error belongs to and its head and mod, when someone wants to read it
+enum class Diagnostic : char
+{
+	unknown_word,
+	det_noun_disagreement,
+	prep_mismatch,
+	prep_invalid_mark,
+	prep_without_complement,
+	rmod_not_participle,
+	rmod_past_with_object,
+	rmod_pres_with_subject,
+	rmod_not_complex,
+	participle_with_subject,
+	verb_subject_disagreement,
+	verbal_object_with_subject,
+	indirect_object_mismatch,
+	be_subject_disagreement,
+	aux_tense_disagreement,
+	aux_subject_disagreement,
+	irregular_past
+};
+
+// one bit for each branch type, 0 for anything else
+constexpr unsigned char branch_bit(char type)
+{
+	switch (type)
+	{
+	case ':': return 1 << 0;
+	case '+': return 1 << 1;
+	case '*': return 1 << 2;
+	case '?': return 1 << 3;
+	case '<': return 1 << 4;
+	case '>': return 1 << 5;
+	case '-': return 1 << 6;
+	default: return 0;
+	}
+}
+
 class Phrase
 {
 public:
@@ -395,10 +484,19 @@ public:
 	using ptr = std::shared_ptr<const Phrase>;
 	using mut_ptr = std::shared_ptr<Phrase>;
 
-	Phrase(int length, Tags syn, Lexeme::ptr lex, LeftRule l = no_left, RightRule r = no_right) 
-		: length(length), syn(syn), sem(move(lex)), left_rule(l), right_rule(r) { }
+	// what rules ask about a phrase, fixed when the phrase is built
+	struct Summary
+	{
+		Kind kind;
+		unsigned char branches = 0; // branch types along the head chain
+		size_t part_errors = 0; // errors in the parts of the phrase
+	};
+
+	Phrase(Summary summary, int length, Tags syn, Lexeme::ptr lex, LeftRule l = no_left, RightRule r = no_right) 
+		: summary(summary), length(length), syn(syn), sem(move(lex)), left_rule(l), right_rule(r) { }
 	virtual ~Phrase() = default;
 
+	const Summary summary;
 	const int length;
 
 	Tags syn;
@@ -409,7 +507,7 @@ public:
 	LeftRule left_rule = no_left;
 	RightRule right_rule = no_right;
 
-	std::vector<std::string> errors;
+	std::vector<Diagnostic> errors;
 
 	struct AG
 	{
@@ -420,36 +518,54 @@ public:
 
 	bool matches(const Shape& shape) const { return syn.hasAll(shape.syn) && (!sem || sem->is(shape.sem)); }
 
-	virtual size_t errorCount() const = 0;
+	Kind kind() const { return summary.kind; }
+
+	size_t errorCount() const { return errors.size() + summary.part_errors; }
 	
-	virtual bool hasBranch(char type) const { return false; }
-	virtual const BinaryPhrase* getBranch(char type) const { return nullptr; }
+	bool hasBranch(char type) const { return (summary.branches & branch_bit(type)) != 0; }
+	const BinaryPhrase* getBranch(char type) const;
 
 	virtual string toString() const = 0;
 };
 
+// checks the kind instead of using RTTI, T needs a static classof(Kind)
+template <class T>
+const T* phrase_cast(const Phrase* p) { return p && T::classof(p->kind()) ? static_cast<const T*>(p) : nullptr; }
+
 class BinaryPhrase : public Phrase
 {
 public:
-	BinaryPhrase(Tags syn, Lexeme::ptr&& lex, char type, Head&& head, Mod&& mod, LeftRule l, RightRule r) :
-		Phrase(head->length + mod->length, syn, move(lex), l, r),
+	BinaryPhrase(Kind kind, Tags syn, Lexeme::ptr&& lex, char type, Head&& head, Mod&& mod, LeftRule l, RightRule r) :
+		Phrase({ kind, static_cast<unsigned char>(branch_bit(type) | head->summary.branches), head->errorCount() + mod->errorCount() },
+			head->length + mod->length, syn, move(lex), l, r),
 		type(type), head(move(head)), mod(move(mod)) { }
 
+	static bool classof(Kind k) { return k == Kind::left || k == Kind::right; }
+
 	const char type;
 	const Head head;
 	const Mod mod;
-
-	size_t errorCount() const final { return errors.size() + head->errorCount() + mod->errorCount(); }
-
-	bool hasBranch(char t) const final { return t == type || head->hasBranch(t); }
-	const BinaryPhrase* getBranch(char t) const final { return t == type ? this : head->getBranch(t); }
 };
 
+inline const BinaryPhrase* Phrase::getBranch(char type) const
+{
+	for (const Phrase* p = this; p->hasBranch(type); )
+	{
+		const auto branch = static_cast<const BinaryPhrase*>(p);
+		if (branch->type == type)
+			return branch;
+		p = branch->head.get();
+	}
+	return nullptr;
+}
+
 class LeftBranch : public BinaryPhrase
 {
 public:
 	LeftBranch(Tags syn, Lexeme::ptr lex, char type, Head head, Mod mod, LeftRule l, RightRule r)
-		: BinaryPhrase(syn, move(lex), type, move(head), move(mod), l, r) { }
+		: BinaryPhrase(Kind::left, syn, move(lex), type, move(head), move(mod), l, r) { }
+
+	static bool classof(Kind k) { return k == Kind::left; }
 
 	string toString() const final
 	{
@@ -460,7 +576,9 @@ class RightBranch : public BinaryPhrase
 {
 public:
 	RightBranch(Tags syn, Lexeme::ptr lex, char type, Head head, Mod mod, LeftRule l, RightRule r)
-		: BinaryPhrase(syn, move(lex), type, move(head), move(mod), l, r) { }
+		: BinaryPhrase(Kind::right, syn, move(lex), type, move(head), move(mod), l, r) { }
+
+	static bool classof(Kind k) { return k == Kind::right; }
 
 	string toString() const final
 	{
@@ -477,14 +595,14 @@ class Morpheme : public Phrase
 public:
 	string orth;
 
-	Morpheme(string orth) : Phrase{ orth.size(),{},{} }, orth(move(orth)) { }
+	Morpheme(string orth) : Phrase{ { Kind::morpheme }, int(orth.size()), {}, {} }, orth(move(orth)) { }
+
+	static bool classof(Kind k) { return k == Kind::morpheme; }
 
 	template <class S>
 	void update(S&& s) { update(s.syn, std::move(s.sem)); }
 	void update(Tags syn, Lexeme::ptr sem);
 
-	size_t errorCount() const final { return errors.size(); }
-
 	string toString() const final { return orth; }
 };
 
@@ -494,12 +612,29 @@ class Word : public Phrase
 public:
 	Word(Lexeme::ptr lex, Phrase::ptr morph);
 
-	size_t errorCount() const { return errors.size() + _morph->errorCount(); }
+	static bool classof(Kind k) { return k == Kind::word; }
+
+	// the morpheme of the word, or the branches of morphemes it was parsed into
+	const Phrase::ptr& morph() const { return _morph; }
 
 	string toString() const final { return _morph->toString(); }
 };
 
+// Masks for skipping the neighbours no rule can use. A rule of head can only build something 
+// from mod if the mask of what it accepts shares a bit with the category of mod
+constexpr unsigned any_category = 1u << 31;
+static_assert(static_cast<unsigned>(Tag::verby) < 31, "tags must leave room for any_category");
+
+inline unsigned category(const Phrase& mod) { return mod.syn.bits() | any_category; }
+unsigned left_accepts(const Phrase& head);
+unsigned right_accepts(const Phrase& head);
+
+
 
 
+std::string describe(Diagnostic error, const Phrase& p);
+// the messages for the errors of p itself, not those of its parts
+std::vector<std::string> describe_errors(const Phrase& p);
 
+// loads the lexicon on first call, after that it is only read and parse_word may be called from any thread
 std::vector<Phrase::ptr> parse_word(std::string_view orth);
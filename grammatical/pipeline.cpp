@@ -0,0 +1,254 @@
+#include "pipeline.h"
+#include "spsc_queue.h"
+#include "tokenizer.h"
+
+#include <exception>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+void write_result(std::ostream& out, size_t number, const std::vector<Parser::Phrases>& results)
+{
+	for (auto&& result : results)
+	{
+		out << number << ':';
+		for (auto&& p : result)
+			out << ' ' << p->toString();
+		out << '\n';
+		for (auto&& p : result)
+			for (auto&& error : describe_errors(*p))
+				out << "  * " << error << '\n';
+	}
+}
+
+namespace
+{
+	struct Sentence
+	{
+		size_t number = 0;
+		std::string text;
+	};
+	struct Analysed
+	{
+		size_t number = 0;
+		std::vector<Parser::Phrases> words;
+	};
+	struct Parsed
+	{
+		size_t number = 0;
+		std::vector<Parser::Phrases> results;
+	};
+
+	struct Lane
+	{
+		SpscQueue<Sentence> sentences;
+		SpscQueue<Analysed> analysed;
+		SpscQueue<Parsed> parsed;
+		size_t words = 0;
+
+		explicit Lane(size_t capacity) : sentences(capacity), analysed(capacity), parsed(capacity) { }
+	};
+
+	bool is_blank(std::string_view text)
+	{
+		return text.find_first_not_of(" \t\r") == std::string_view::npos;
+	}
+
+	bool is_mark(char c) { return c == '.' || c == '!' || c == '?'; }
+
+	// Where the first sentence in text from start ends: at a newline, or at a '.', '!' or '?' followed by whitespace, 
+	// so marks inside words, as in "3.5" and the first of "e.g.", don't end one. Not at a mark at the end of text, 
+	// the next chunk may go on with the word
+	size_t sentence_end(std::string_view text, size_t start)
+	{
+		for (auto end = start; (end = text.find_first_of("\n.!?", end)) != std::string_view::npos; ++end)
+		{
+			if (text[end] == '\n')
+				return end;
+			if (end + 1 == text.size())
+				return std::string_view::npos;
+			switch (text[end + 1])
+			{
+			case ' ': case '\t': case '\r': case '\n':
+				return end;
+			}
+		}
+		return std::string_view::npos;
+	}
+
+	// where to cut text that has grown to max bytes without a sentence end: 
+	// after the last space, or else before the code point that crosses max
+	size_t cut(std::string_view text, size_t max)
+	{
+		const auto space = text.find_last_of(" \t", max - 1);
+		if (space != std::string_view::npos && space > 0)
+			return space + 1;
+		size_t at = max;
+		while (at > 0 && (static_cast<unsigned char>(text[at]) & 0xc0) == 0x80)
+			--at;
+		return at > 0 ? at : max;
+	}
+}
+
+PipelineCounts run_pipeline(std::istream& in, std::ostream& out, const PipelineOptions& options)
+{
+	const unsigned lane_count = std::max(options.lanes, 1u);
+	const size_t max_sentence = std::max<size_t>(options.max_sentence, 1);
+	PipelineCounts counts;
+
+	SpscQueue<std::string> chunks(4);
+	std::vector<std::unique_ptr<Lane>> lanes;
+	for (unsigned i = 0; i < lane_count; ++i)
+		lanes.emplace_back(std::make_unique<Lane>(options.queue_capacity));
+
+	std::mutex error_lock;
+	std::exception_ptr error;
+	const auto fail = [&]
+	{
+		{
+			std::lock_guard<std::mutex> lock(error_lock);
+			if (!error)
+				error = std::current_exception();
+		}
+		chunks.cancel();
+		for (auto&& lane : lanes)
+		{
+			lane->sentences.cancel();
+			lane->analysed.cancel();
+			lane->parsed.cancel();
+		}
+	};
+	std::vector<std::thread> threads;
+	const auto stage = [&](auto body)
+	{
+		threads.emplace_back([&fail, body]
+		{
+			try
+			{
+				body();
+			}
+			catch (...)
+			{
+				fail();
+			}
+		});
+	};
+
+	stage([&]
+	{
+		for (;;)
+		{
+			std::string chunk(options.chunk_size, '\0');
+			in.read(&chunk[0], std::streamsize(chunk.size()));
+			chunk.resize(size_t(in.gcount()));
+			if (chunk.empty())
+				break;
+			counts.bytes += chunk.size();
+			if (!chunks.push(std::move(chunk)))
+				return;
+		}
+		chunks.close();
+	});
+
+	stage([&]
+	{
+		size_t count = 0;
+		const auto emit = [&](std::string_view text)
+		{
+			// the marks that end it, as in "?!" and "...", are not part of it
+			while (!text.empty() && is_mark(text.back()))
+				text.remove_suffix(1);
+			if (is_blank(text))
+				return true;
+			auto& lane = *lanes[count % lane_count];
+			return lane.sentences.push({ options.first_number + count++, std::string(text) });
+		};
+
+		std::string pending;
+		std::string chunk;
+		while (chunks.pop(chunk))
+		{
+			// what is pending has no end, but for a mark at its end that may turn out to be one
+			size_t start = 0;
+			size_t end = pending.empty() ? 0 : pending.size() - 1;
+			pending += chunk;
+			while ((end = sentence_end(pending, end)) != std::string::npos)
+			{
+				if (!emit(std::string_view(pending).substr(start, end - start)))
+					return;
+				start = ++end;
+			}
+			pending.erase(0, start);
+			while (pending.size() > max_sentence)
+			{
+				const auto at = cut(pending, max_sentence);
+				if (!emit(std::string_view(pending).substr(0, at)))
+					return;
+				pending.erase(0, at);
+			}
+		}
+		if (!emit(pending))
+			return;
+		for (auto&& lane : lanes)
+			lane->sentences.close();
+	});
+
+	for (auto&& lane_ptr : lanes)
+	{
+		auto& lane = *lane_ptr;
+		stage([&lane, &options]
+		{
+			Sentence sentence;
+			while (lane.sentences.pop(sentence))
+			{
+				Analysed analysed{ sentence.number, {} };
+				Tokenizer<std::string_view> tokens{ sentence.text };
+				tokens.cache = options.cache;
+				while (auto word = tokens.next())
+					analysed.words.emplace_back(std::move(*word));
+				lane.words += analysed.words.size();
+				if (!lane.analysed.push(std::move(analysed)))
+					return;
+			}
+			lane.analysed.close();
+		});
+		stage([&lane, &options]
+		{
+			Parser parser(options.forest);
+			Analysed analysed;
+			while (lane.analysed.pop(analysed))
+			{
+				parser.clear();
+				for (auto&& word : analysed.words)
+					parser.push(word);
+				if (!lane.parsed.push({ analysed.number, parser.run({}, options.covers) }))
+					return;
+			}
+			lane.parsed.close();
+		});
+	}
+
+	try
+	{
+		Parsed parsed;
+		for (size_t i = 0; lanes[i % lane_count]->parsed.pop(parsed); ++i)
+		{
+			write_result(out, parsed.number, parsed.results);
+			++counts.sentences;
+		}
+	}
+	catch (...)
+	{
+		fail();
+	}
+	for (auto&& t : threads)
+		t.join();
+	if (error)
+		std::rethrow_exception(error);
+
+	for (auto&& lane : lanes)
+		counts.words += lane->words;
+	return counts;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "parser.h"
+#include "word_cache.h"
+
+#include <algorithm>
+#include <iosfwd>
+#include <thread>
+
+// Writes the parses of sentence number in the notation of the README, one line for each parse, 
+// "number: phrase phrase", followed by a line "  * description" for each diagnostic in it
+void write_result(std::ostream& out, size_t number, const std::vector<Parser::Phrases>& results);
+
+struct PipelineOptions
+{
+	// analysing and parsing lanes, each is two threads
+	unsigned lanes = std::max(std::thread::hardware_concurrency() / 2, 1u);
+	// bytes read at a time
+	size_t chunk_size = 1 << 16;
+	// capacity of the queues between the stages of each lane
+	size_t queue_capacity = 256;
+	// sentences without an end this long are cut at a space
+	size_t max_sentence = 1 << 12;
+	// number of the first sentence in the output
+	size_t first_number = 1;
+	Forest forest = Forest::expanded;
+	// parses written for each sentence at most, of those as good as the best
+	size_t covers = Parser::default_covers;
+	// words are looked up here if it is set
+	WordCache* cache = nullptr;
+};
+
+struct PipelineCounts
+{
+	size_t bytes = 0;
+	size_t sentences = 0;
+	size_t words = 0;
+};
+
+// Parses a document as it is read, in stages that overlap: a thread reads chunks, one splits them into sentences 
+// at newlines and at '.', '!' and '?' followed by whitespace, the lanes analyse the words and parse the sentences, 
+// and the calling thread writes the results in order with write_result. 
+// The stages are connected by bounded queues, so memory use doesn't grow with the document. 
+// Sentences are dealt to the lanes in turn and taken back in the same turn, which keeps them in order. 
+// Rethrows the first exception of any stage after stopping the others
+PipelineCounts run_pipeline(std::istream& in, std::ostream& out, const PipelineOptions& options = {});
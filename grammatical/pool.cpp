@@ -0,0 +1,123 @@
+#include "pool.h"
+
+#include <algorithm>
+#include <utility>
+
+WorkPool::WorkPool(unsigned threads) : _size(std::max(threads, 1u)), _ranges(new Range[_size])
+{
+	_threads.reserve(_size - 1);
+	for (unsigned worker = 1; worker < _size; ++worker)
+		_threads.emplace_back([this, worker] { _loop(worker); });
+}
+
+WorkPool::~WorkPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		_stop = true;
+	}
+	_wake.notify_all();
+	for (auto&& t : _threads)
+		t.join();
+}
+
+bool WorkPool::_take(unsigned worker, size_t& index)
+{
+	auto& range = _ranges[worker];
+	std::lock_guard<std::mutex> lock(range.lock);
+	if (range.next == range.end)
+		return false;
+	index = range.next++;
+	return true;
+}
+
+bool WorkPool::_steal(unsigned worker)
+{
+	for (unsigned i = 1; i < _size; ++i)
+	{
+		auto& victim = _ranges[(worker + i) % _size];
+		size_t first, last;
+		{
+			std::lock_guard<std::mutex> lock(victim.lock);
+			if (victim.next == victim.end)
+				continue;
+			last = victim.end;
+			first = victim.end = victim.next + (victim.end - victim.next) / 2;
+		}
+		auto& own = _ranges[worker];
+		std::lock_guard<std::mutex> lock(own.lock);
+		own.next = first;
+		own.end = last;
+		return true;
+	}
+	return false;
+}
+
+void WorkPool::_work(unsigned worker)
+{
+	try
+	{
+		size_t index;
+		while (_take(worker, index) || (_steal(worker) && _take(worker, index)))
+			(*_job)(index, worker);
+	}
+	catch (...)
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		if (!_error)
+			_error = std::current_exception();
+		// leave the remaining indices to the other workers
+		for (unsigned i = 0; i < _size; ++i)
+		{
+			std::lock_guard<std::mutex> range_lock(_ranges[i].lock);
+			_ranges[i].next = _ranges[i].end;
+		}
+	}
+}
+
+void WorkPool::_loop(unsigned worker)
+{
+	size_t generation = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(_lock);
+			_wake.wait(lock, [&] { return _stop || _generation != generation; });
+			if (_stop)
+				return;
+			generation = _generation;
+		}
+		_work(worker);
+		{
+			std::lock_guard<std::mutex> lock(_lock);
+			--_busy;
+		}
+		_done.notify_one();
+	}
+}
+
+void WorkPool::run(size_t count, const Job& job)
+{
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+		for (unsigned i = 0; i < _size; ++i)
+		{
+			std::lock_guard<std::mutex> range_lock(_ranges[i].lock);
+			_ranges[i].next = count * i / _size;
+			_ranges[i].end = count * (i + 1) / _size;
+		}
+		_job = &job;
+		_busy = _size - 1;
+		_error = nullptr;
+		++_generation;
+	}
+	_wake.notify_all();
+
+	_work(0);
+
+	std::unique_lock<std::mutex> lock(_lock);
+	_done.wait(lock, [&] { return _busy == 0; });
+	_job = nullptr;
+	if (_error)
+		std::rethrow_exception(std::exchange(_error, nullptr));
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads that split index ranges between them, 
+// workers that run out of indices steal half of what another worker has left
+class WorkPool
+{
+public:
+	using Job = std::function<void(size_t index, unsigned worker)>;
+
+	explicit WorkPool(unsigned threads = std::thread::hardware_concurrency());
+	~WorkPool();
+
+	WorkPool(const WorkPool&) = delete;
+	WorkPool& operator=(const WorkPool&) = delete;
+
+	// number of workers, including the thread calling run
+	unsigned size() const { return _size; }
+
+	// calls job(index, worker) for every index below count and returns when all are done, 
+	// the calling thread works as worker 0
+	void run(size_t count, const Job& job);
+private:
+	struct Range
+	{
+		std::mutex lock;
+		size_t next = 0;
+		size_t end = 0;
+	};
+	const unsigned _size;
+	std::unique_ptr<Range[]> _ranges;
+	std::vector<std::thread> _threads;
+
+	std::mutex _lock;
+	std::condition_variable _wake;
+	std::condition_variable _done;
+	const Job* _job = nullptr;
+	size_t _generation = 0;
+	unsigned _busy = 0;
+	bool _stop = false;
+	std::exception_ptr _error;
+
+	bool _take(unsigned worker, size_t& index);
+	bool _steal(unsigned worker);
+	void _work(unsigned worker);
+	void _loop(unsigned worker);
+};
@@ -1,39 +1,8 @@
-#include "phrase.h"
-#include <cassert>
+#include "rules.h"
+#include "arena.h"
+#include <algorithm>
 #include <unordered_map>
 
-namespace args
-{
-	template <Rel R>
-	bool rel(const Argument& arg) { return arg.rel == R; }
-	static constexpr auto head = rel<Rel::spec>;
-	static constexpr auto mod = rel<Rel::mod>;
-	static constexpr auto comp = rel<Rel::comp>;
-	static constexpr auto bicomp = rel<Rel::bicomp>;
-
-	static auto sem = ranged::map([](const Argument& arg) { return arg.sem; });
-
-	template <Rel R>
-	auto matching(const Lexeme::ptr& s)
-	{ 
-		assert(s != nullptr);
-		return [=](const Argument& arg) { return arg.rel == R && s->is(arg.sem); };
-	}
-
-	template <Rel R>
-	auto matching(Mark m, const Lexeme::ptr& s)
-	{
-		assert(s != nullptr);
-		return [=](const Argument& arg) { return arg.rel == R && arg.mark == m && s->is(arg.sem); };
-	}
-
-	template <Rel R>
-	auto matching(Mark m, const Phrase::ptr& p)
-	{
-		assert(p != nullptr);
-		return [=](const Argument& arg) { return arg.rel == R && arg.mark == m && p->matches(arg); };
-	}
-}
 struct KeepHeadLexeme
 {
 	Lexeme::ptr operator()(Lexeme::ptr head) { return head; }
@@ -41,14 +10,14 @@ struct KeepHeadLexeme
 
 std::shared_ptr<LeftBranch> merge(const Mod& mod, char type, const Head& head, LeftRule l, RightRule r)
 {
-	auto result = std::make_shared<LeftBranch>(head->syn, head->sem, type, head, mod, l, r);
+	auto result = make_phrase<LeftBranch>(head->syn, head->sem, type, head, mod, l, r);
 	result->args = head->args;
 	return result;
 }
 
 std::shared_ptr<RightBranch> merge(const Head& head, char type, const Mod& mod, LeftRule l, RightRule r)
 {
-	auto result = std::make_shared<RightBranch>(head->syn, head->sem, type, head, mod, l, r);
+	auto result = make_phrase<RightBranch>(head->syn, head->sem, type, head, mod, l, r);
 	result->args = head->args;
 	return result;
 }
@@ -82,227 +51,232 @@ decltype(auto) append(A&& a, B&& b)
 
 
 
-RuleOutput noun_det(const Mod& mod, const Head& head)
+void noun_det(const Mod& mod, const Head& head, RuleSink& out)
 {
 	if (mod->syn.has(Tag::gen))
 	{
 		const auto result = merge(mod, ':', head, no_left, no_right);
 
 		if (!head->agreesOn({ Tag::sg, Tag::pl, Tag::uc }).with(*mod))
-			result->errors.emplace_back("det " + mod->toString() + " and noun " + head->toString() + " not compatible");
-		return { result };
+			result->errors.emplace_back(Diagnostic::det_noun_disagreement);
+		out.emit(result);
 	}
-	return {};
 }
 
-RuleOutput ad_adad(const Mod& mod, const Head& head)
+void ad_adad(const Mod& mod, const Head& head, RuleSink& out)
 {
 	if (mod->syn.has(Tag::adad))
-		return { merge(mod, '>', head, no_left, no_right) };
-	return {};
+		out.emit(merge(mod, '>', head, no_left, no_right));
 }
 
-RuleOutput noun_adjective(const Mod& mod, const Head& head)
+void noun_adjective(const Mod& mod, const Head& head, RuleSink& out)
 {
 	if (mod->syn.has(Tag::adn))
-		return { merge(mod, '>', head, noun_adjective, no_right) };
-	return noun_det(mod, head);
+		out.emit(merge(mod, '>', head, noun_adjective, no_right));
+	else
+		noun_det(mod, head, out);
 }
 
-RuleOutput head_prep(const Head& head, const Mod& mod)
+void head_prep(const Head& head, const Mod& mod, RuleSink& out)
 {
 	if (mod->syn.has(Tag::prep))
 	{
 		const auto result = merge(head, '<', mod, head->left_rule, head_prep);
 
-		if (auto branch = std::dynamic_pointer_cast<const BinaryPhrase>(mod))
+		if (auto branch = phrase_cast<BinaryPhrase>(mod.get()))
 		{
 			assert(branch->type == '+');
 			if (const auto M = mark(branch->head->toString()); M && *M != Mark::None)
 			{
 				auto arg_match = result->args.extract(args::matching<Rel::mod>(*M, branch->mod)); 
 				if (arg_match.empty())
-					result->errors.emplace_back("preposition " + mod->toString() + " does not match " + head->toString());
+					result->errors.emplace_back(Diagnostic::prep_mismatch);
 
 			}
 			else
-				result->errors.emplace_back("preposition phrase " + head->toString() + " is not a valid mark");
+				result->errors.emplace_back(Diagnostic::prep_invalid_mark);
 		}
 		else
-			result->errors.emplace_back("preposition " + mod->toString() + " modifying " + head->toString() + " has no complement");
+			result->errors.emplace_back(Diagnostic::prep_without_complement);
 
-		return { result };
+		out.emit(result);
 	}
-	return {};
 }
 
-RuleOutput noun_rmod(const Head& head, const Mod& mod)
+void noun_rmod(const Head& head, const Mod& mod, RuleSink& out)
 {
 	if (mod->syn.has(Tag::part) && !mod->hasBranch('?'))
 	{
 		const auto result = merge(head, '<', mod, noun_adjective, no_right);
 
 		if (!mod->syn.has(Tag::part))
-			result->errors.emplace_back("verb right-modifying noun must be a participle");
+			result->errors.emplace_back(Diagnostic::rmod_not_participle);
 		else
 		{
 			if (mod->syn.has(Tag::past) && (mod->hasBranch('+') || mod->hasBranch('*')))
-				result->errors.emplace_back("past participle modifying noun can't have an object");
+				result->errors.emplace_back(Diagnostic::rmod_past_with_object);
 			if (mod->syn.has(Tag::pres) && mod->hasBranch(':'))
-				result->errors.emplace_back("present participle modifying noun can't have subject");
-			if (dynamic_cast<const Word*>(mod.get()))
-				result->errors.emplace_back("verb phrase must be complex to right-modify a noun");
+				result->errors.emplace_back(Diagnostic::rmod_pres_with_subject);
+			if (mod->kind() == Kind::word)
+				result->errors.emplace_back(Diagnostic::rmod_not_complex);
 		}
 
-		return { result };
+		out.emit(result);
 	}
-	return head_prep(head, mod);
+	else
+		head_prep(head, mod, out);
 }
 
-RuleOutput verb_spec(const Mod& mod, const Head& head)
+void verb_spec(const Mod& mod, const Head& head, RuleSink& out)
 {
 	if (mod->syn.has(Tag::nom))
 	{
 		const auto result = merge(mod, ':', head, no_left, no_right);
 
 		if (!head->syn.has(Tag::fin))
-			result->errors.emplace_back("verb participle cannot take a subject");
+			result->errors.emplace_back(Diagnostic::participle_with_subject);
 		if (!subject_verb_agreement(mod, head))
-			result->errors.emplace_back("verb-subject disagreement");
+			result->errors.emplace_back(Diagnostic::verb_subject_disagreement);
 
-		return { result };
+		out.emit(result);
 	}
-	return {};
 }
 
-void check_verbal_object(const Head& head, const Mod& mod, const Phrase::mut_ptr& match)
+void check_verbal_object(const Mod& mod, const Phrase::mut_ptr& match)
 {
 	if (mod->syn.hasAny({ Tag::part, Tag::dict }) && (mod->hasBranch(':') || mod->hasBranch('?')))
-		match->errors.emplace_back("verbal object to " + head->toString() + " cannot have subject");
+		match->errors.emplace_back(Diagnostic::verbal_object_with_subject);
 }
 
+// The chained rule is a template argument, so each chain compiles into one function 
+// emitting straight into the caller's sink
 template <RawRightRule NextRight, Tag... VerbTarget>
-RuleOutput head_comp(const Head& head, const Mod& mod)
+void head_comp(const Head& head, const Mod& mod, RuleSink& out)
 {
-	auto result = NextRight(head, mod);
+	NextRight(head, mod, out);
 	for (auto&& comp : head->args.select(args::comp))
 		if (mod->matches(comp))
 		{
 			const auto match = merge(head, '+', mod, head->left_rule, NextRight);
 
-			check_verbal_object(head, mod, match);
+			check_verbal_object(mod, match);
 
 			match->args.erase(args::comp);
-			result.emplace_back(match);
+			out.emit(match);
 		}
-
-	return result;
 }
 template <RawRightRule NextRule>
-RuleOutput verb_bicomp(const Head& head, const Mod& mod)
+void verb_bicomp(const Head& head, const Mod& mod, RuleSink& out)
 {
-	auto result = NextRule(head, mod);
+	NextRule(head, mod, out);
 
 	if (mod->syn.hasAny(Tag::akk))
 	{
 		const auto match = merge(head, '*', mod, head->left_rule, NextRule);
 
 		if (!mod->sem || !mod->sem->matchesAny(head->args.select(args::bicomp) | args::sem))
-			match->errors.emplace_back("indirect object " + mod->toString() + " does not match " + head->toString());
+			match->errors.emplace_back(Diagnostic::indirect_object_mismatch);
 
-		check_verbal_object(head, mod, match);
+		check_verbal_object(mod, match);
 
 		match->args.erase(args::bicomp);
-		result.emplace_back(match);
+		out.emit(match);
 	}
-	return result;
 }
 
-RuleOutput verb_adv(const Head& head, const Mod& mod)
+void verb_adv(const Head& head, const Mod& mod, RuleSink& out)
 {
 	if (mod->syn.has(Tag::adv))
 	{
 		const auto match = merge(head, '<', mod, head->left_rule, head_prep);
 
-		return { match };
+		out.emit(match);
 	}
-	return head_prep(head, mod);
+	else
+		head_prep(head, mod, out);
 }
 
 
-RuleOutput be_lspec(const Mod& mod, const Head& head)
+void be_lspec(const Mod& mod, const Head& head, RuleSink& out)
 {
 	if (mod->syn.has(Tag::nom))
 	{
 		auto match = merge(mod, ':', head, no_left, no_right);
 		if (!subject_be_agreement(mod, head))
-			match->errors.emplace_back("subject " + mod->toString() + "does not agree with " + head->toString());
-		return { match };
+			match->errors.emplace_back(Diagnostic::be_subject_disagreement);
+		out.emit(match);
 	}
-	return {};
 }
 
 
 template <Tag... Tense>
-RuleOutput aux_comp(const Head& head, const Mod& mod)
+void aux_comp(const Head& head, const Mod& mod, RuleSink& out)
 {
-	auto result = head_prep(head, mod);
+	head_prep(head, mod, out);
 	if (mod->syn.hasAny(Tag::akk))
 	{
-		result.emplace_back(merge(head, '+', mod, head->left_rule, head_prep));
+		out.emit(merge(head, '+', mod, head->left_rule, head_prep));
 	}
 	else if (mod->syn.hasAny({ Tag::fin, Tag::part }))
 	{
 		auto match = merge(head, '+', mod, head->left_rule, head_prep);
 
 		if (!mod->syn.hasAll({ Tense... }))
-			match->errors.emplace_back("tense of object " + mod->toString() + " does not agree with auxillary " + head->toString());
+			match->errors.emplace_back(Diagnostic::aux_tense_disagreement);
 
-		check_verbal_object(head, mod, match);
+		check_verbal_object(mod, match);
 
-		result.emplace_back(match);
+		out.emit(match);
 	}
-
-	return result;
-
 }
 
 
-RuleOutput be_rspec(const Head& head, const Mod& mod)
+void be_rspec(const Head& head, const Mod& mod, RuleSink& out)
 {
-	auto result = aux_comp<Tag::part>(head, mod);
+	aux_comp<Tag::part>(head, mod, out);
 
 	if (mod->syn.has(Tag::nom))
 	{
 		auto match = merge(head, '?', mod, no_left, aux_comp<Tag::part>);
 		if (!subject_be_agreement(mod, head))
-			match->errors.emplace_back("subject " + mod->toString() + " does not agree with verb " + head->toString());
-		result.emplace_back(match);
+			match->errors.emplace_back(Diagnostic::aux_subject_disagreement);
+		out.emit(match);
 	}
-	return result;
 }
 
 template <RawRightRule NextRule>
-RuleOutput aux_rspec(const Head& head, const Mod& mod)
+void aux_rspec(const Head& head, const Mod& mod, RuleSink& out)
 {
-	auto result = NextRule(head, mod);
+	NextRule(head, mod, out);
 
 	if (mod->syn.has(Tag::nom))
 	{
 		auto match = merge(head, '?', mod, no_left, NextRule);
 		if (!subject_verb_agreement(mod, head))
-			match->errors.emplace_back("subject " + mod->toString() +" does not agree with verb " + head->toString());
-		result.emplace_back(match);
+			match->errors.emplace_back(Diagnostic::aux_subject_disagreement);
+		out.emit(match);
 	}
-	return result;
 }
 
-Word::Word(Lexeme::ptr lexeme, Phrase::ptr morph) : Phrase{ 1, morph->syn, move(lexeme) }, _morph{ morph }
+template void aux_comp<Tag::part>(const Head&, const Mod&, RuleSink&);
+template void aux_comp<Tag::part, Tag::past>(const Head&, const Mod&, RuleSink&);
+template void aux_comp<Tag::fin, Tag::pres, Tag::pl>(const Head&, const Mod&, RuleSink&);
+template void aux_rspec<aux_comp<Tag::part, Tag::past>>(const Head&, const Mod&, RuleSink&);
+template void aux_rspec<aux_comp<Tag::fin, Tag::pres, Tag::pl>>(const Head&, const Mod&, RuleSink&);
+template void head_comp<verb_adv, Tag::dict>(const Head&, const Mod&, RuleSink&);
+template void head_comp<verb_adv, Tag::part, Tag::pres>(const Head&, const Mod&, RuleSink&);
+template void head_comp<no_right, Tag::part, Tag::pres>(const Head&, const Mod&, RuleSink&);
+template void verb_bicomp<head_comp<verb_adv, Tag::dict>>(const Head&, const Mod&, RuleSink&);
+template void verb_bicomp<head_comp<verb_adv, Tag::part, Tag::pres>>(const Head&, const Mod&, RuleSink&);
+template void aux_rspec<verb_bicomp<head_comp<verb_adv, Tag::dict>>>(const Head&, const Mod&, RuleSink&);
+
+Word::Word(Lexeme::ptr lexeme, Phrase::ptr morph) : 
+	Phrase{ { Kind::word, 0, morph->errorCount() }, 1, morph->syn, move(lexeme) }, _morph{ morph }
 {
 	static constexpr auto have_right = aux_rspec<aux_comp<Tag::part, Tag::past>>;
 	static constexpr auto presf_aux_right = aux_rspec<aux_comp<Tag::fin, Tag::pres, Tag::pl>>;
 	args = _morph->args;
-	static const std::unordered_map<string, std::pair<LeftRule, RightRule>> special = 
+	static constexpr auto special = make_perfect_hash<std::pair<LeftRule, RightRule>>(
 	{
 		{ "be", { no_left, aux_comp<Tag::part> } },
 		{ "been", { no_left, aux_comp<Tag::part> } },
@@ -320,12 +294,12 @@ Word::Word(Lexeme::ptr lexeme, Phrase::ptr morph) : Phrase{ 1, morph->syn, move(
 		{ "did", { verb_spec, presf_aux_right }},
 		{ "doing", { no_left, presf_aux_right }},
 		{ "done", { no_left, presf_aux_right }}
-	};
-	if (auto m = std::dynamic_pointer_cast<const Morpheme>(_morph))
-		if (auto found = special.find(m->orth); found != special.end())
+	});
+	if (auto m = phrase_cast<Morpheme>(_morph.get()))
+		if (auto found = special.find(m->orth))
 		{
-			left_rule = found->second.first;
-			right_rule = found->second.second;
+			left_rule = found->first;
+			right_rule = found->second;
 		}
 	if (left_rule == no_left && right_rule == no_right) // nothing special was found
 	{
@@ -364,31 +338,30 @@ std::shared_ptr<Phrase> operator-(std::shared_ptr<Phrase> p, Tags tags)
 	return p;
 }
 
-RuleOutput noun_suffix(const Head& head, const Mod& mod)
+void noun_suffix(const Head& head, const Mod& mod, RuleSink& out)
 {
-	if (auto morph = std::dynamic_pointer_cast<const Morpheme>(mod); 
+	if (auto morph = phrase_cast<Morpheme>(mod.get()); 
 		morph && mod->syn.has(Tag::suffix))
 	{
 		if (morph->orth == "s")
 		{
-			return { merge(head, '-', mod, no_left, no_right) - Tags(Tag::sg, Tag::rc) + Tag::pl };
+			out.emit(merge(head, '-', mod, no_left, no_right) - Tags(Tag::sg, Tag::rc) + Tag::pl);
 		}
 	}
-	return {};
 }
 
-RuleOutput verb_suffix(const Head& head, const Mod& mod)
+void verb_suffix(const Head& head, const Mod& mod, RuleSink& out)
 {
-	if (auto morph = std::dynamic_pointer_cast<const Morpheme>(mod); 
+	if (auto morph = phrase_cast<Morpheme>(mod.get()); 
 		morph && mod->syn.has(Tag::suffix))
 	{
 		if (morph->orth == "ing")
 		{
-			return { merge(head, '-', mod, no_left, noun_suffix)
+			out.emit(merge(head, '-', mod, no_left, noun_suffix)
 				- Tags(Tag::fin, tags::person, tags::number, tags::verb_regularity)
-				+ Tags(Tag::part, Tag::pres) };
+				+ Tags(Tag::part, Tag::pres));
 		}
-		if (morph->orth== "ed")
+		else if (morph->orth== "ed")
 		{
 			auto match = merge(head, '-', mod, no_left, noun_suffix)
 				- Tags(Tag::fin, tags::person, tags::number, tags::verb_regularity)
@@ -400,18 +373,17 @@ RuleOutput verb_suffix(const Head& head, const Mod& mod)
 				if (!head->syn.has(Tag::rpart))
 					match->syn.remove(Tag::part);
 				if (!head->syn.hasAny({ Tag::rpart, Tag::rpast }))
-					match->errors.emplace_back("verb does not have a regular past tense");
+					match->errors.emplace_back(Diagnostic::irregular_past);
 			}
-			return { match };
+			out.emit(match);
 		}
-		if (morph->orth == "er" || morph->orth == "ee")
+		else if (morph->orth == "er" || morph->orth == "ee")
 		{
-			return { merge(head, '-', mod, no_left, noun_suffix)
+			out.emit(merge(head, '-', mod, no_left, noun_suffix)
 				- Tags(Tag::fin, tags::person, tags::number, tags::verb_regularity)
-				+ Tags(Tag::nom, Tag::akk, tags::sg3, Tag::rc) };
+				+ Tags(Tag::nom, Tag::akk, tags::sg3, Tag::rc));
 		}
 	}
-	return {};
 }
 
 void Morpheme::_add_args(const Lexeme& s)
@@ -443,3 +415,133 @@ void Morpheme::update(Tags new_syn, Lexeme::ptr new_sem)
 		right_rule = verb_suffix;
 	}
 }
+
+// What a rule can take as mod, from the tests it starts with. 
+// A filter may let through mods the rule turns down, but never the other way around
+struct ModFilter
+{
+	Tags tags; // the mod needs one of these
+	bool any = false; // any mod will do
+	bool comp = false; // any mod will do if the head has a complement argument
+
+	constexpr ModFilter operator|(ModFilter b) const
+	{
+		b.tags.insert(tags);
+		b.any |= any;
+		b.comp |= comp;
+		return b;
+	}
+
+	unsigned accepts(const Phrase& head) const
+	{
+		if (any || (comp && std::any_of(head.args.begin(), head.args.end(), args::comp)))
+			return ~0u;
+		return tags.bits();
+	}
+};
+
+namespace filters
+{
+	static constexpr ModFilter none;
+	static constexpr ModFilter noun_det{ Tag::gen };
+	static constexpr ModFilter ad_adad{ Tag::adad };
+	static constexpr ModFilter noun_adjective = ModFilter{ Tag::adn } | noun_det;
+	static constexpr ModFilter verb_spec{ Tag::nom };
+	static constexpr ModFilter be_lspec{ Tag::nom };
+
+	static constexpr ModFilter head_prep{ Tag::prep };
+	static constexpr ModFilter noun_rmod = ModFilter{ Tag::part } | head_prep;
+	static constexpr ModFilter verb_adv = ModFilter{ Tag::adv } | head_prep;
+	static constexpr ModFilter aux_comp = ModFilter{ { Tag::akk, Tag::fin, Tag::part } } | head_prep;
+	static constexpr ModFilter be_rspec = ModFilter{ Tag::nom } | aux_comp;
+	static constexpr ModFilter suffix{ Tag::suffix };
+
+	constexpr ModFilter head_comp(ModFilter next) { return ModFilter{ {}, false, true } | next; }
+	constexpr ModFilter verb_bicomp(ModFilter next) { return ModFilter{ Tag::akk } | next; }
+	constexpr ModFilter aux_rspec(ModFilter next) { return ModFilter{ Tag::nom } | next; }
+}
+
+// rules missing from the tables accept anything
+template <class Rule>
+unsigned accepts(const std::unordered_map<Rule, ModFilter>& table, Rule rule, const Phrase& head)
+{
+	const auto found = table.find(rule);
+	return found == table.end() ? ~0u : found->second.accepts(head);
+}
+
+unsigned left_accepts(const Phrase& head)
+{
+	static const std::unordered_map<RawLeftRule, ModFilter> table =
+	{
+		{ no_left, filters::none },
+		{ noun_det, filters::noun_det },
+		{ ad_adad, filters::ad_adad },
+		{ noun_adjective, filters::noun_adjective },
+		{ verb_spec, filters::verb_spec },
+		{ be_lspec, filters::be_lspec }
+	};
+	return accepts<RawLeftRule>(table, *head.left_rule, head);
+}
+
+unsigned right_accepts(const Phrase& head)
+{
+	static const std::unordered_map<RawRightRule, ModFilter> table =
+	{
+		{ no_right, filters::none },
+		{ head_prep, filters::head_prep },
+		{ noun_rmod, filters::noun_rmod },
+		{ verb_adv, filters::verb_adv },
+		{ aux_comp<Tag::part>, filters::aux_comp },
+		{ aux_comp<Tag::part, Tag::past>, filters::aux_comp },
+		{ aux_comp<Tag::fin, Tag::pres, Tag::pl>, filters::aux_comp },
+		{ be_rspec, filters::be_rspec },
+		{ aux_rspec<aux_comp<Tag::part, Tag::past>>, filters::aux_rspec(filters::aux_comp) },
+		{ aux_rspec<aux_comp<Tag::fin, Tag::pres, Tag::pl>>, filters::aux_rspec(filters::aux_comp) },
+		{ head_comp<verb_adv, Tag::dict>, filters::head_comp(filters::verb_adv) },
+		{ verb_bicomp<head_comp<verb_adv, Tag::dict>>, filters::verb_bicomp(filters::head_comp(filters::verb_adv)) },
+		{ aux_rspec<verb_bicomp<head_comp<verb_adv, Tag::dict>>>, filters::aux_rspec(filters::verb_bicomp(filters::head_comp(filters::verb_adv))) },
+		{ head_comp<verb_adv, Tag::part, Tag::pres>, filters::head_comp(filters::verb_adv) },
+		{ verb_bicomp<head_comp<verb_adv, Tag::part, Tag::pres>>, filters::verb_bicomp(filters::head_comp(filters::verb_adv)) },
+		{ head_comp<no_right, Tag::part, Tag::pres>, filters::head_comp(filters::none) },
+		{ noun_suffix, filters::suffix },
+		{ verb_suffix, filters::suffix }
+	};
+	return accepts<RawRightRule>(table, *head.right_rule, head);
+}
+
+std::string describe(Diagnostic error, const Phrase& p)
+{
+	const auto branch = phrase_cast<BinaryPhrase>(&p);
+	const auto head = [&] { return branch ? branch->head->toString() : p.toString(); };
+	const auto mod = [&] { return branch ? branch->mod->toString() : std::string(); };
+	switch (error)
+	{
+	case Diagnostic::unknown_word: return "unknown word " + p.toString();
+	case Diagnostic::det_noun_disagreement: return "det " + mod() + " and noun " + head() + " not compatible";
+	case Diagnostic::prep_mismatch: return "preposition " + mod() + " does not match " + head();
+	case Diagnostic::prep_invalid_mark: return "preposition phrase " + head() + " is not a valid mark";
+	case Diagnostic::prep_without_complement: return "preposition " + mod() + " modifying " + head() + " has no complement";
+	case Diagnostic::rmod_not_participle: return "verb right-modifying noun must be a participle";
+	case Diagnostic::rmod_past_with_object: return "past participle modifying noun can't have an object";
+	case Diagnostic::rmod_pres_with_subject: return "present participle modifying noun can't have subject";
+	case Diagnostic::rmod_not_complex: return "verb phrase must be complex to right-modify a noun";
+	case Diagnostic::participle_with_subject: return "verb participle cannot take a subject";
+	case Diagnostic::verb_subject_disagreement: return "verb-subject disagreement";
+	case Diagnostic::verbal_object_with_subject: return "verbal object to " + head() + " cannot have subject";
+	case Diagnostic::indirect_object_mismatch: return "indirect object " + mod() + " does not match " + head();
+	case Diagnostic::be_subject_disagreement: return "subject " + mod() + " does not agree with " + head();
+	case Diagnostic::aux_tense_disagreement: return "tense of object " + mod() + " does not agree with auxillary " + head();
+	case Diagnostic::aux_subject_disagreement: return "subject " + mod() + " does not agree with verb " + head();
+	case Diagnostic::irregular_past: return "verb does not have a regular past tense";
+	}
+	return "unknown error";
+}
+
+std::vector<std::string> describe_errors(const Phrase& p)
+{
+	std::vector<std::string> result;
+	result.reserve(p.errors.size());
+	for (auto error : p.errors)
+		result.emplace_back(describe(error, p));
+	return result;
+}
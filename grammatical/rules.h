@@ -0,0 +1,80 @@
+#pragma once
+
+#include "phrase.h"
+
+#include <cassert>
+
+// Tests on arguments, for select, extract and erase on a Bag<Argument>
+namespace args
+{
+	template <Rel R>
+	bool rel(const Argument& arg) { return arg.rel == R; }
+	static constexpr auto head = rel<Rel::spec>;
+	static constexpr auto mod = rel<Rel::mod>;
+	static constexpr auto comp = rel<Rel::comp>;
+	static constexpr auto bicomp = rel<Rel::bicomp>;
+
+	static auto sem = ranged::map([](const Argument& arg) { return arg.sem; });
+
+	template <Rel R>
+	auto matching(const Lexeme::ptr& s)
+	{
+		assert(s != nullptr);
+		return [=](const Argument& arg) { return arg.rel == R && s->is(arg.sem); };
+	}
+
+	template <Rel R>
+	auto matching(Mark m, const Lexeme::ptr& s)
+	{
+		assert(s != nullptr);
+		return [=](const Argument& arg) { return arg.rel == R && arg.mark == m && s->is(arg.sem); };
+	}
+
+	template <Rel R>
+	auto matching(Mark m, const Phrase::ptr& p)
+	{
+		assert(p != nullptr);
+		return [=](const Argument& arg) { return arg.rel == R && arg.mark == m && p->matches(arg); };
+	}
+}
+
+// a branch with the syn, sem and args of head, which the rules then adjust
+std::shared_ptr<LeftBranch> merge(const Mod& mod, char type, const Head& head, LeftRule l, RightRule r);
+std::shared_ptr<RightBranch> merge(const Head& head, char type, const Mod& mod, LeftRule l, RightRule r);
+
+// rules for a mod to the left of the head
+void noun_det(const Mod& mod, const Head& head, RuleSink& out);
+void ad_adad(const Mod& mod, const Head& head, RuleSink& out);
+void noun_adjective(const Mod& mod, const Head& head, RuleSink& out);
+void verb_spec(const Mod& mod, const Head& head, RuleSink& out);
+void be_lspec(const Mod& mod, const Head& head, RuleSink& out);
+
+// rules for a mod to the right of the head
+void head_prep(const Head& head, const Mod& mod, RuleSink& out);
+void noun_rmod(const Head& head, const Mod& mod, RuleSink& out);
+void verb_adv(const Head& head, const Mod& mod, RuleSink& out);
+void be_rspec(const Head& head, const Mod& mod, RuleSink& out);
+void noun_suffix(const Head& head, const Mod& mod, RuleSink& out);
+void verb_suffix(const Head& head, const Mod& mod, RuleSink& out);
+
+template <RawRightRule NextRight, Tag... VerbTarget>
+void head_comp(const Head& head, const Mod& mod, RuleSink& out);
+template <RawRightRule NextRule>
+void verb_bicomp(const Head& head, const Mod& mod, RuleSink& out);
+template <Tag... Tense>
+void aux_comp(const Head& head, const Mod& mod, RuleSink& out);
+template <RawRightRule NextRule>
+void aux_rspec(const Head& head, const Mod& mod, RuleSink& out);
+
+// the chains the words are given, only these are compiled
+extern template void aux_comp<Tag::part>(const Head&, const Mod&, RuleSink&);
+extern template void aux_comp<Tag::part, Tag::past>(const Head&, const Mod&, RuleSink&);
+extern template void aux_comp<Tag::fin, Tag::pres, Tag::pl>(const Head&, const Mod&, RuleSink&);
+extern template void aux_rspec<aux_comp<Tag::part, Tag::past>>(const Head&, const Mod&, RuleSink&);
+extern template void aux_rspec<aux_comp<Tag::fin, Tag::pres, Tag::pl>>(const Head&, const Mod&, RuleSink&);
+extern template void head_comp<verb_adv, Tag::dict>(const Head&, const Mod&, RuleSink&);
+extern template void head_comp<verb_adv, Tag::part, Tag::pres>(const Head&, const Mod&, RuleSink&);
+extern template void head_comp<no_right, Tag::part, Tag::pres>(const Head&, const Mod&, RuleSink&);
+extern template void verb_bicomp<head_comp<verb_adv, Tag::dict>>(const Head&, const Mod&, RuleSink&);
+extern template void verb_bicomp<head_comp<verb_adv, Tag::part, Tag::pres>>(const Head&, const Mod&, RuleSink&);
+extern template void aux_rspec<verb_bicomp<head_comp<verb_adv, Tag::dict>>>(const Head&, const Mod&, RuleSink&);
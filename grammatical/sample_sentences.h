@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string_view>
+
+// The sentences main.cpp shows and the README lists the parses of, the benchmarks parse them too
+inline constexpr std::string_view sample_sentences[] =
+{
+	"a wish",
+	"the book",
+	"have arrived",
+	"they will come",
+	"that English teacher",
+	"my latest idea",
+	"computers are very expensive",
+	"do you sell old books",
+	"we ate a lot of food",
+	"we bought some new furniture",
+	"that is useful information",
+	"he gave me some useful advice",
+	"they gave us a lot of information",
+	"let me give you some advice",
+	"let me give you a piece of advice",
+	"that is a useful piece of equipment",
+	//"we bought a few bits of furniture for the new apartment", // 'a few' is unsolved
+	//"how much luggage have you got", // question pronouns not yet supported
+	"she had six separate items of luggage",
+	"everybody is watching",
+	"is everybody watching",
+	"they had worked hard",
+	"had they worked hard",
+	"he has finished work",
+	"has he finished work",
+	"everybody had been working hard",
+	"had everybody been working hard",
+	"will they come",
+	"he might come",
+	"might he come",
+	"they will have arrived by now",
+	"will they have arrived by now",
+	"she would have been listening",
+	"would she have been listening",
+	"the work will be finished soon",
+	"will the work be finished soon",
+	"they might have been invited to the party",
+	"might they have been invited to the party",
+	"they eat garf",
+	"they give me books",
+	"he give me books"
+};
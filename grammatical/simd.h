@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#define GRAMMATICAL_AVX2 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GRAMMATICAL_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// index of the lowest set bit, bits must not be 0
+inline unsigned lowest_bit(uint64_t bits)
+{
+#if defined(_MSC_VER)
+	unsigned long i;
+	_BitScanForward64(&i, bits);
+	return i;
+#else
+	return unsigned(__builtin_ctzll(bits));
+#endif
+}
+
+// Bit i of the result is set if masks[i] shares a bit with mask or categories[i] shares a bit with category,
+// count is at most 64. This is the test the chart makes before calling any rule on a pair of neighbours
+inline uint64_t matching_masks(const unsigned* categories, const unsigned* masks, size_t count, unsigned category, unsigned mask)
+{
+	uint64_t result = 0;
+	size_t i = 0;
+#if defined(GRAMMATICAL_AVX2)
+	const __m256i c = _mm256_set1_epi32(int(category));
+	const __m256i m = _mm256_set1_epi32(int(mask));
+	const __m256i zero = _mm256_setzero_si256();
+	for (; i + 8 <= count; i += 8)
+	{
+		const __m256i cs = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(categories + i));
+		const __m256i ms = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(masks + i));
+		const __m256i none = _mm256_and_si256(
+			_mm256_cmpeq_epi32(_mm256_and_si256(ms, c), zero),
+			_mm256_cmpeq_epi32(_mm256_and_si256(cs, m), zero));
+		result |= uint64_t(~_mm256_movemask_ps(_mm256_castsi256_ps(none)) & 0xff) << i;
+	}
+#elif defined(GRAMMATICAL_SSE2)
+	const __m128i c = _mm_set1_epi32(int(category));
+	const __m128i m = _mm_set1_epi32(int(mask));
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128i cs = _mm_loadu_si128(reinterpret_cast<const __m128i*>(categories + i));
+		const __m128i ms = _mm_loadu_si128(reinterpret_cast<const __m128i*>(masks + i));
+		const __m128i none = _mm_and_si128(
+			_mm_cmpeq_epi32(_mm_and_si128(ms, c), zero),
+			_mm_cmpeq_epi32(_mm_and_si128(cs, m), zero));
+		result |= uint64_t(~_mm_movemask_ps(_mm_castsi128_ps(none)) & 0xf) << i;
+	}
+#endif
+	for (; i < count; ++i)
+		if ((masks[i] & category) || (categories[i] & mask))
+			result |= uint64_t(1) << i;
+	return result;
+}
+
+// Number of bytes at the start of text that are ASCII letters or digits, size at most. 
+// Copies them to folded with A-Z made lower case, folded must have room for size bytes
+inline size_t fold_ascii_alnum(const char* text, size_t size, char* folded)
+{
+	size_t i = 0;
+#if defined(GRAMMATICAL_AVX2) || defined(GRAMMATICAL_SSE2)
+	// a byte is in [first, last] if moving first down to -128 leaves it below -128 + the length of the range
+	const auto in_range = [](__m128i bytes, char first, char last)
+	{
+		const __m128i moved = _mm_sub_epi8(bytes, _mm_set1_epi8(char(first + 128)));
+		return _mm_cmplt_epi8(moved, _mm_set1_epi8(char(last - first + 1 - 128)));
+	};
+	for (; i + 16 <= size; i += 16)
+	{
+		const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+		const __m128i upper = in_range(bytes, 'A', 'Z');
+		const __m128i word = _mm_or_si128(_mm_or_si128(upper, in_range(bytes, 'a', 'z')), in_range(bytes, '0', '9'));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(folded + i), _mm_add_epi8(bytes, _mm_and_si128(upper, _mm_set1_epi8(0x20))));
+		const int mask = _mm_movemask_epi8(word);
+		if (mask != 0xffff)
+			return i + lowest_bit(uint64_t(~mask & 0xffff));
+	}
+#endif
+	for (; i < size; ++i)
+	{
+		const char ch = text[i];
+		if (ch >= 'A' && ch <= 'Z')
+			folded[i] = char(ch + 0x20);
+		else if ((ch >= 'a' && ch <= 'z') || (ch >= '0' && ch <= '9'))
+			folded[i] = ch;
+		else
+			break;
+	}
+	return i;
+}
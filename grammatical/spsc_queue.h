@@ -0,0 +1,112 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <utility>
+
+// Bounded queue from one producing thread to one consuming thread, without locks. 
+// A full queue makes the producer wait, which is how a stage that runs ahead of the next one is held back
+template <class T>
+class SpscQueue
+{
+	const size_t _mask;
+	const std::unique_ptr<T[]> _slots;
+
+	// each side keeps its index and its last look at the other side's index on its own cache line
+	alignas(64) std::atomic<size_t> _tail{ 0 }; // next slot to push to, written by the producer
+	size_t _known_head = 0;
+	alignas(64) std::atomic<size_t> _head{ 0 }; // next slot to pop from, written by the consumer
+	size_t _known_tail = 0;
+	alignas(64) std::atomic<bool> _closed{ false };
+	std::atomic<bool> _cancelled{ false };
+
+	static size_t _round_up(size_t capacity)
+	{
+		size_t result = 1;
+		while (result < capacity)
+			result *= 2;
+		return result;
+	}
+
+	// spins a little, then yields, then sleeps, so a stage that waits long doesn't hold on to a core
+	static void _back_off(unsigned& waits)
+	{
+		if (++waits < 64)
+			return;
+		if (waits < 128)
+			std::this_thread::yield();
+		else
+			std::this_thread::sleep_for(std::chrono::microseconds(50));
+	}
+public:
+	// capacity is rounded up to a power of two
+	explicit SpscQueue(size_t capacity) : _mask(_round_up(capacity) - 1), _slots(new T[_mask + 1]) { }
+
+	SpscQueue(const SpscQueue&) = delete;
+	SpscQueue& operator=(const SpscQueue&) = delete;
+
+	size_t capacity() const { return _mask + 1; }
+
+	// producer only, leaves value as it was if the queue is full
+	bool try_push(T& value)
+	{
+		const auto tail = _tail.load(std::memory_order_relaxed);
+		if (tail - _known_head > _mask)
+		{
+			_known_head = _head.load(std::memory_order_acquire);
+			if (tail - _known_head > _mask)
+				return false;
+		}
+		_slots[tail & _mask] = std::move(value);
+		_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// consumer only
+	bool try_pop(T& value)
+	{
+		const auto head = _head.load(std::memory_order_relaxed);
+		if (head == _known_tail)
+		{
+			_known_tail = _tail.load(std::memory_order_acquire);
+			if (head == _known_tail)
+				return false;
+		}
+		value = std::move(_slots[head & _mask]);
+		_slots[head & _mask] = T();
+		_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	// producer only, waits for room, returns false if the queue was cancelled
+	bool push(T value)
+	{
+		for (unsigned waits = 0; !_cancelled.load(std::memory_order_relaxed); _back_off(waits))
+			if (try_push(value))
+				return true;
+		return false;
+	}
+
+	// consumer only, waits for a value, returns false when the queue is closed and empty or cancelled
+	bool pop(T& value)
+	{
+		for (unsigned waits = 0; !_cancelled.load(std::memory_order_relaxed); _back_off(waits))
+		{
+			if (try_pop(value))
+				return true;
+			// everything pushed before close is visible once it is seen closed
+			if (_closed.load(std::memory_order_acquire))
+				return try_pop(value);
+		}
+		return false;
+	}
+
+	// producer only, after the last push
+	void close() { _closed.store(true, std::memory_order_release); }
+
+	// either side, makes every push and pop give up, for when the other side will never come
+	void cancel() { _cancelled.store(true, std::memory_order_relaxed); }
+};
@@ -0,0 +1,102 @@
+#include "parser.h"
+#include "tokenizer.h"
+
+#include <chrono>
+#include <iostream>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Checks of the parser that the sample sentences in main.cpp don't show, run by ctest.
+// Each test returns normally and failed checks are counted, so one run reports every failure
+static int failures = 0;
+
+static void check(bool ok, const std::string& what)
+{
+	if (!ok)
+	{
+		std::cerr << "FAILED: " << what << '\n';
+		++failures;
+	}
+}
+
+// the alternatives for one word, as the pipeline gives them to the parser
+static Parser::Phrases word(std::string_view orth)
+{
+	return *Tokenizer<std::string_view>(orth).next();
+}
+
+static std::vector<std::string> texts(const std::vector<Parser::Phrases>& covers)
+{
+	std::vector<std::string> result;
+	for (auto&& cover : covers)
+	{
+		std::string text;
+		for (auto&& p : cover)
+			text += p->toString() + ' ';
+		result.push_back(text);
+	}
+	return result;
+}
+
+// editing one word over and over must not keep what every edit dropped
+static void repeated_replace()
+{
+	const std::vector<std::string_view> words = { "they", "might", "have", "been", "invited", "to", "the", "party" };
+	Parser parser;
+	for (auto w : words)
+		parser.push(word(w));
+	const auto expected = texts(parser.run());
+	const auto built = parser.memory();
+
+	for (int n = 0; n < 5000; ++n)
+	{
+		parser.replace(6, word(n % 2 ? "the" : "a"));
+		parser.run();
+	}
+	check(parser.memory() < 2 * built + (2 << 20), "memory stays bounded over repeated replace, " + std::to_string(parser.memory()) + " bytes");
+
+	Budget budget;
+	budget.max_memory = 2 * built;
+	parser.replace(6, word("the"));
+	const auto results = texts(parser.run(budget));
+	check(!parser.truncated(), "a budget of twice the memory of one parse is not used up by dropped items");
+	check(results == expected, "the edited sentence parses as it did before the edits");
+}
+
+// Every word of the sentence has two readings that nothing joins, so it has 2^98 covers that are 
+// as good as each other. Only the first few are made, and the first is found without trying the rest
+static void ambiguous_sentence()
+{
+	Parser parser;
+	for (int i = 0; i < 98; ++i)
+		parser.push(word("come"));
+	const auto start = std::chrono::steady_clock::now();
+	const auto results = parser.run();
+	const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	check(results.size() == Parser::default_covers, "run() returns default_covers covers, not " + std::to_string(results.size()));
+	check(seconds < 1, "a highly ambiguous sentence parses in bounded time, took " + std::to_string(seconds) + " s");
+	check(parser.memory() < (1 << 20), "a highly ambiguous sentence parses in bounded memory, " + std::to_string(parser.memory()) + " bytes");
+	// the two readings of "come" print the same, so covers are told apart by their phrases
+	std::set<std::vector<const Phrase*>> distinct;
+	for (auto&& cover : results)
+	{
+		std::vector<const Phrase*> phrases;
+		for (auto&& p : cover)
+			phrases.push_back(p.get());
+		distinct.insert(phrases);
+	}
+	check(distinct.size() == results.size(), "every cover is returned once");
+	check(parser.results(1).size() == 1, "results(k) returns at most k covers");
+}
+
+int main()
+{
+	repeated_replace();
+	ambiguous_sentence();
+	if (failures == 0)
+		std::cout << "all passed\n";
+	return failures == 0 ? 0 : 1;
+}
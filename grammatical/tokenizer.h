@@ -0,0 +1,41 @@
+#pragma once
+
+#include "phrase.h"
+#include "tokens.h"
+#include "word_cache.h"
+
+#include <optional>
+
+template <class Stream>
+class Tokenizer
+{
+	TokenIterator<Stream> _it;
+
+	std::vector<Phrase::ptr> _lookup(std::string_view orth) const { return cache ? *cache->get(orth) : parse_word(orth); }
+public:
+	template <class... Args>
+	Tokenizer(Args&&... args) : _it(std::forward<Args>(args)...) { }
+
+	// if set, words are looked up here instead of being parsed every time they occur
+	WordCache* cache = nullptr;
+
+	std::optional<std::vector<Phrase::ptr>> next()
+	{
+		if (_it.isWhitespace()) ++_it;
+		if (!_it || _it.isNewline())
+			return std::nullopt;
+		// words that aren't in the lexicon as written are looked up case folded, so "The" is found as "the"
+		auto result = _lookup(*_it);
+		if (result.empty() && _it.folded() != *_it)
+			result = _lookup(_it.folded());
+		if (result.empty())
+		{
+			const auto new_morph = std::make_shared<Morpheme>(std::string(*_it));
+			auto new_word = std::make_shared<Word>(new_morph->sem, new_morph);
+			new_word->errors.emplace_back(Diagnostic::unknown_word);
+			result.emplace_back(move(new_word));
+		}
+		++_it;
+		return result;
+	}
+};
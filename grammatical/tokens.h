@@ -1,8 +1,11 @@
 #pragma once
 
 #include "ranged.h"
+#include "mapped_file.h"
+#include "utf8.h"
 
 #include <string>
+#include <string_view>
 #include <memory>
 #include <sstream>
 
@@ -11,14 +14,27 @@ class TokenIterator
 {
 	std::shared_ptr<Input> _input;
 	std::string _token;
+	std::string _folded; // of the token if it is a word
+	std::string _pending; // bytes read from _input to see where a word ends, but not part of it
+	std::string _sequence;
+
+	int _peek() { return _pending.empty() ? _input->peek() : static_cast<unsigned char>(_pending.front()); }
+	int _get()
+	{
+		if (_pending.empty())
+			return _input->get();
+		const auto ch = static_cast<unsigned char>(_pending.front());
+		_pending.erase(0, 1);
+		return ch;
+	}
 
 	void _read_break()
 	{
 		_token = "\n";
-		for (;;) switch (_input->peek())
+		for (;;) switch (_peek())
 		{
 		case ' ': case '\t': case '\r': case '\n':
-			_input->get();
+			_get();
 			continue;
 		default:
 			return;
@@ -27,35 +43,69 @@ class TokenIterator
 	void _read_white()
 	{
 		_token = " ";
-		for (;;) switch (_input->peek())
+		for (;;) switch (_peek())
 		{
-		case ' ': case '\t': _input->get(); continue;
+		case ' ': case '\t': _get(); continue;
 		case '\r': case '\n': _read_break(); return;
 		default:
 			return;
 		}
 	}
 
-	static bool _is_white(char ch) { return ch == ' ' || ch == '\t'; }
-	static bool _is_newline(char ch) { return ch == '\r' || ch == '\n'; }
+	// Reads the code point that starts with lead into _sequence and returns whether it is a word character. 
+	// If it isn't valid UTF-8, _sequence is only lead and the bytes after it are read again
+	bool _read_code_point(char lead, char32_t& cp)
+	{
+		_sequence.assign(1, lead);
+		const auto length = utf8::sequence_length(static_cast<unsigned char>(lead));
+		while (_sequence.size() < length && (_peek() & 0xc0) == 0x80)
+			_sequence.push_back(char(_get()));
+		if (utf8::decode(_sequence, cp) == 0)
+		{
+			_pending.insert(0, _sequence, 1);
+			_sequence.resize(1);
+			return false;
+		}
+		return utf8::is_word(cp);
+	}
 
 	void _read_token()
 	{
 		_token.clear();
-		switch (const char ch = _input->get())
+		_folded.clear();
+		switch (const int ch = _get())
 		{
 		case ' ': case '\t': _read_white(); return;
 		case '\r': case '\n': _read_break(); return;
 		default:
-			if (!_input->good())
+			if (ch == std::char_traits<char>::eof())
 				return;
-			_token.push_back(ch);
-			if (isalnum(ch))
+			char32_t cp;
+			const bool word = _read_code_point(char(ch), cp);
+			_token = _sequence;
+			if (!word)
+				return;
+			utf8::encode(utf8::fold(cp), _folded);
+			for (;;)
 			{
-				while (isalnum(_input->peek()))
-					_token.push_back(_input->get());
+				const int next = _peek();
+				if (next == std::char_traits<char>::eof())
+					return;
+				_get();
+				if (next < 0x80 && utf8::is_word(char32_t(next)))
+				{
+					_token.push_back(char(next));
+					_folded.push_back(char(utf8::fold(char32_t(next))));
+					continue;
+				}
+				if (next < 0x80 || !_read_code_point(char(next), cp))
+				{
+					_pending.insert(0, next < 0x80 ? std::string(1, char(next)) : _sequence);
+					return;
+				}
+				_token += _sequence;
+				utf8::encode(utf8::fold(cp), _folded);
 			}
-			return;
 		}
 	}
 public:
@@ -69,11 +119,107 @@ public:
 	const std::string& operator*() const { return _token; }
 	const std::string* operator->() const { return &_token; }
 
+	// the token case folded if it is a word, or else the token itself
+	std::string_view folded() const { return _folded.empty() ? std::string_view(_token) : std::string_view(_folded); }
+
+	bool operator==(End) const { return _token.empty(); }
+	bool operator!=(End) const { return !operator==(End{}); }
+
+	explicit operator bool() const { return !_token.empty(); }
+
+	bool isNewline()    const { return _token.size() == 1 && _token.front() == '\n'; }
+	bool isWhitespace() const { return _token.size() == 1 && _token.front() == ' '; }
+
+	void flushLine()
+	{
+		if (isNewline())
+			return;
+		while (_get() != '\n') {}
+		_read_break();
+	}
+	bool skipws()
+	{
+		if (isWhitespace())
+			_read_token();
+		return _token.empty() || isNewline();
+	}
+};
+
+// Tokens of text that is already in memory, as views into it, split the same way as from a stream. 
+// Runs of whitespace come out as " " or "\n" like above, offset() tells where they and every other token start
+template <>
+class TokenIterator<std::string_view>
+{
+	std::string_view _text;
+	size_t _next = 0;
+	size_t _offset = 0;
+	std::string_view _token;
+	std::string _folded; // of the token if it is a word
+
+	bool _at(char a, char b) const { return _next < _text.size() && (_text[_next] == a || _text[_next] == b); }
+
+	void _read_break()
+	{
+		_token = "\n";
+		while (_at(' ', '\t') || _at('\r', '\n'))
+			++_next;
+	}
+	void _read_white()
+	{
+		_token = " ";
+		while (_at(' ', '\t'))
+			++_next;
+		if (_at('\r', '\n'))
+			_read_break();
+	}
+
+	void _read_token()
+	{
+		_offset = _next;
+		_folded.clear();
+		if (_next == _text.size())
+		{
+			_token = {};
+			return;
+		}
+		switch (_text[_next++])
+		{
+		case ' ': case '\t': _read_white(); return;
+		case '\r': case '\n': _read_break(); return;
+		default:
+			// a word, or else one code point, or one byte that isn't valid UTF-8
+			const auto rest = _text.substr(_offset);
+			char32_t cp;
+			const auto length = utf8::decode(rest, cp);
+			if (length > 0 && utf8::is_word(cp))
+				_next = _offset + utf8::scan_word(rest, _folded);
+			else
+				_next = _offset + std::max<size_t>(length, 1);
+			_token = _text.substr(_offset, _next - _offset);
+			return;
+		}
+	}
+public:
+	struct End { };
+
+	explicit TokenIterator(std::string_view text) : _text(text) { _read_token(); }
+
+	TokenIterator& operator++() { _read_token(); return *this; }
+
+	std::string_view operator*() const { return _token; }
+	const std::string_view* operator->() const { return &_token; }
+
+	// the token case folded if it is a word, or else the token itself
+	std::string_view folded() const { return _folded.empty() ? _token : std::string_view(_folded); }
+
 	bool operator==(End) const { return _token.empty(); }
 	bool operator!=(End) const { return !operator==(End{}); }
 
 	explicit operator bool() const { return !_token.empty(); }
 
+	// byte offset of the token in the text
+	size_t offset() const { return _offset; }
+
 	bool isNewline()    const { return _token.size() == 1 && _token.front() == '\n'; }
 	bool isWhitespace() const { return _token.size() == 1 && _token.front() == ' '; }
 
@@ -81,7 +227,8 @@ public:
 	{
 		if (isNewline())
 			return;
-		while (_input->get() != '\n') {}
+		const auto newline = _text.find('\n', _next);
+		_next = newline == std::string_view::npos ? _text.size() : newline + 1;
 		_read_break();
 	}
 	bool skipws()
@@ -92,6 +239,19 @@ public:
 	}
 };
 
+// Tokens of a file mapped into memory, the mapping lives as long as any copy of the iterator
+template <>
+class TokenIterator<MappedFile> : public TokenIterator<std::string_view>
+{
+	std::shared_ptr<const MappedFile> _file;
+
+	explicit TokenIterator(std::shared_ptr<const MappedFile> file) :
+		TokenIterator<std::string_view>(std::string_view(file->data(), file->size())), _file(std::move(file)) { }
+public:
+	// throws std::runtime_error if the file can't be opened or mapped
+	explicit TokenIterator(const std::string& path) : TokenIterator(std::make_shared<const MappedFile>(path)) { }
+};
+
 template <class Input>
 struct std::iterator_traits<TokenIterator<Input>> : ranged::InputInteratorTraits<TokenIterator<Input>> { };
 
@@ -0,0 +1,24 @@
+#include "../lexicon.h"
+
+#include <exception>
+#include <iostream>
+
+// Compiles lexemes.txt and words.txt in the working directory to the file named by the first argument
+int main(int argc, char* argv[])
+{
+	if (argc != 2)
+	{
+		std::cerr << "usage: " << argv[0] << " <output>\n";
+		return 2;
+	}
+	try
+	{
+		compile_lexicon(argv[1]);
+	}
+	catch (std::exception& e)
+	{
+		std::cerr << e.what() << '\n';
+		return 1;
+	}
+	return 0;
+}
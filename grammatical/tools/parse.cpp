@@ -0,0 +1,111 @@
+#include "../lexicon.h"
+#include "../pipeline.h"
+#include "peak_rss.h"
+
+#include <chrono>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Parses the sentences of the files named, or of stdin, and writes the parses in the notation of the README. 
+// Sentences end at newlines and at '.', '!' and '?' followed by whitespace. Throughput and peak memory go to stderr
+static void usage(const char* program)
+{
+	std::cerr << "usage: " << program << " [options] [file...]\n"
+		"reads stdin if no file is given or a file is -\n"
+		"  --lanes n       analysing and parsing lanes, each is two threads\n"
+		"  --packed        pack the chart\n"
+		"  --covers n      parses written for each sentence at most (default " << Parser::default_covers << ")\n"
+		"  --cache n       words to keep in the word cache, 0 for none (default 65536)\n"
+		"  --lexicon file  load a lexicon written by compile_lexicon instead of lexemes.txt and words.txt\n"
+		"  --quiet         only report throughput\n";
+}
+
+int main(int argc, char* argv[])
+{
+	std::ios::sync_with_stdio(false);
+	try
+	{
+		PipelineOptions options;
+		std::vector<std::string> files;
+		size_t cache_size = 1 << 16;
+		bool quiet = false;
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string arg = argv[i];
+			const auto value = [&]
+			{
+				if (i + 1 == argc)
+					throw std::runtime_error(arg + " needs a value");
+				return std::string(argv[++i]);
+			};
+			if (arg == "--lanes")
+				options.lanes = unsigned(std::stoul(value()));
+			else if (arg == "--packed")
+				options.forest = Forest::packed;
+			else if (arg == "--covers")
+				options.covers = std::stoul(value());
+			else if (arg == "--cache")
+				cache_size = std::stoul(value());
+			else if (arg == "--lexicon")
+				set_compiled_lexicon(value());
+			else if (arg == "--quiet")
+				quiet = true;
+			else if (arg == "--help" || arg == "-h")
+			{
+				usage(argv[0]);
+				return 0;
+			}
+			else if (arg.size() > 1 && arg.front() == '-')
+			{
+				usage(argv[0]);
+				return 2;
+			}
+			else
+				files.push_back(arg);
+		}
+		if (files.empty())
+			files.emplace_back("-");
+
+		WordCache cache(cache_size);
+		if (cache_size > 0)
+			options.cache = &cache;
+
+		// load the lexicon here, so it isn't counted in the throughput
+		parse_word({});
+
+		std::ostream discard(nullptr);
+		std::ostream& out = quiet ? discard : std::cout;
+		PipelineCounts total;
+		const auto start = std::chrono::steady_clock::now();
+		for (auto&& file : files)
+		{
+			std::ifstream opened;
+			if (file != "-")
+			{
+				opened.open(file, std::ios::binary);
+				if (!opened)
+					throw std::runtime_error("could not open " + file);
+			}
+			options.first_number = total.sentences + 1;
+			const auto counts = run_pipeline(file == "-" ? std::cin : opened, out, options);
+			total.bytes += counts.bytes;
+			total.sentences += counts.sentences;
+			total.words += counts.words;
+		}
+		out.flush();
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		std::cerr << total.sentences << " sentences, " << total.words << " tokens, " << total.bytes << " bytes in " << seconds << " s\n"
+			<< total.sentences / seconds << " sentences/s, " << total.words / seconds << " tokens/s, "
+			<< "peak RSS " << peak_rss() / (1024.0 * 1024.0) << " MiB\n";
+	}
+	catch (std::exception& e)
+	{
+		std::cerr << e.what() << '\n';
+		return 1;
+	}
+	return 0;
+}
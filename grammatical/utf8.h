@@ -0,0 +1,154 @@
+#pragma once
+
+#include "simd.h"
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+
+// What the tokenizer needs to know about UTF-8: where code points and words end, and what to look words up as
+namespace utf8
+{
+	// Decodes the code point at the start of text into cp and returns its length, 
+	// or 0 if text doesn't start with a complete, shortest-form sequence for a code point
+	inline size_t decode(std::string_view text, char32_t& cp)
+	{
+		if (text.empty())
+			return 0;
+		const auto lead = static_cast<unsigned char>(text[0]);
+		size_t length;
+		char32_t min;
+		if (lead < 0x80) { cp = lead; return 1; }
+		else if ((lead & 0xe0) == 0xc0) { length = 2; min = 0x80; cp = lead & 0x1f; }
+		else if ((lead & 0xf0) == 0xe0) { length = 3; min = 0x800; cp = lead & 0x0f; }
+		else if ((lead & 0xf8) == 0xf0) { length = 4; min = 0x10000; cp = lead & 0x07; }
+		else return 0;
+
+		if (text.size() < length)
+			return 0;
+		for (size_t i = 1; i < length; ++i)
+		{
+			const auto byte = static_cast<unsigned char>(text[i]);
+			if ((byte & 0xc0) != 0x80)
+				return 0;
+			cp = (cp << 6) | (byte & 0x3f);
+		}
+		if (cp < min || cp > 0x10ffff || (cp >= 0xd800 && cp <= 0xdfff))
+			return 0;
+		return length;
+	}
+
+	// the number of bytes the sequence that starts with lead should have, 0 if lead can't start one
+	inline size_t sequence_length(unsigned char lead)
+	{
+		if (lead < 0x80) return 1;
+		if ((lead & 0xe0) == 0xc0) return 2;
+		if ((lead & 0xf0) == 0xe0) return 3;
+		if ((lead & 0xf8) == 0xf0) return 4;
+		return 0;
+	}
+
+	inline void encode(char32_t cp, std::string& out)
+	{
+		if (cp < 0x80)
+			out.push_back(char(cp));
+		else if (cp < 0x800)
+		{
+			out.push_back(char(0xc0 | (cp >> 6)));
+			out.push_back(char(0x80 | (cp & 0x3f)));
+		}
+		else if (cp < 0x10000)
+		{
+			out.push_back(char(0xe0 | (cp >> 12)));
+			out.push_back(char(0x80 | ((cp >> 6) & 0x3f)));
+			out.push_back(char(0x80 | (cp & 0x3f)));
+		}
+		else
+		{
+			out.push_back(char(0xf0 | (cp >> 18)));
+			out.push_back(char(0x80 | ((cp >> 12) & 0x3f)));
+			out.push_back(char(0x80 | ((cp >> 6) & 0x3f)));
+			out.push_back(char(0x80 | (cp & 0x3f)));
+		}
+	}
+
+	// ASCII letters and digits, and everything beyond ASCII but the spaces, punctuation and symbols of the common blocks. 
+	// Apostrophes are not part of words, "don't" is three tokens whichever apostrophe it is written with
+	inline bool is_word(char32_t cp)
+	{
+		if (cp < 0x80)
+			return (cp >= '0' && cp <= '9') || ((cp | 0x20) >= 'a' && (cp | 0x20) <= 'z');
+		if (cp < 0xc0)
+			return cp == 0xaa || cp == 0xb5 || cp == 0xba;
+		if (cp == 0xd7 || cp == 0xf7)
+			return false;
+		if (cp >= 0x2000 && cp <= 0x206f) // general punctuation
+			return false;
+		if (cp >= 0x20a0 && cp <= 0x20cf) // currency symbols
+			return false;
+		if (cp >= 0x3000 && cp <= 0x303f) // CJK symbols and punctuation
+			return false;
+		if (cp >= 0xff01 && cp <= 0xff0f) // fullwidth punctuation
+			return false;
+		return cp != 0xfeff;
+	}
+
+	// Simple case folding of the Latin, Greek and Cyrillic letters, other code points are returned as they are
+	inline char32_t fold(char32_t cp)
+	{
+		if (cp < 0x80)
+			return cp >= 'A' && cp <= 'Z' ? cp + 0x20 : cp;
+		if (cp >= 0xc0 && cp <= 0xde && cp != 0xd7)
+			return cp + 0x20;
+		if (cp >= 0x100 && cp <= 0x17f)
+		{
+			if (cp == 0x130) return 'i';
+			if (cp == 0x178) return 0xff;
+			if (cp == 0x17f) return 's';
+			const bool odd_upper = (cp >= 0x139 && cp <= 0x148) || (cp >= 0x179 && cp <= 0x17e);
+			if (cp == 0x138 || cp == 0x149)
+				return cp;
+			return (cp % 2 == 1) == odd_upper ? cp + 1 : cp;
+		}
+		if (cp >= 0x391 && cp <= 0x3a9 && cp != 0x3a2)
+			return cp + 0x20;
+		if (cp >= 0x410 && cp <= 0x42f)
+			return cp + 0x20;
+		if (cp >= 0x400 && cp <= 0x40f)
+			return cp + 0x50;
+		return cp;
+	}
+
+	// Whether text starts with a word character
+	inline bool starts_word(std::string_view text)
+	{
+		char32_t cp;
+		return decode(text, cp) > 0 && is_word(cp);
+	}
+
+	// Scans the word at the start of text, appends it case folded to folded and returns its length in bytes. 
+	// Runs of ASCII letters and digits, the bulk of most text, are scanned and folded in vector registers
+	inline size_t scan_word(std::string_view text, std::string& folded)
+	{
+		size_t i = 0;
+		while (i < text.size())
+		{
+			const auto chunk = std::min<size_t>(text.size() - i, 64);
+			const auto at = folded.size();
+			folded.resize(at + chunk);
+			const auto n = fold_ascii_alnum(text.data() + i, chunk, &folded[at]);
+			folded.resize(at + n);
+			i += n;
+			if (n == chunk)
+				continue;
+
+			char32_t cp;
+			const auto length = decode(text.substr(i), cp);
+			if (length < 2 || !is_word(cp))
+				break;
+			encode(fold(cp), folded);
+			i += length;
+		}
+		return i;
+	}
+}
@@ -0,0 +1,103 @@
+#include "word_cache.h"
+
+#include <algorithm>
+#include <mutex>
+
+WordCache::WordCache(size_t capacity, unsigned shards) :
+	_capacity(std::max<size_t>(capacity, 1)),
+	_shard_capacity((_capacity + std::max(shards, 1u) - 1) / std::max(shards, 1u)),
+	_shards(std::max(shards, 1u))
+{
+	for (auto&& shard : _shards)
+	{
+		shard.slots = std::make_unique<Slot[]>(_shard_capacity);
+		shard.index.reserve(_shard_capacity);
+	}
+}
+
+WordCache::Analyses WordCache::get(std::string_view orth)
+{
+	auto& shard = _shard(orth);
+	{
+		std::shared_lock lock(shard.lock);
+		if (const auto found = shard.index.find(orth); found != shard.index.end())
+		{
+			auto& slot = shard.slots[found->second];
+			slot.used.store(true, std::memory_order_relaxed);
+			shard.hits.fetch_add(1, std::memory_order_relaxed);
+			return slot.analyses;
+		}
+	}
+	shard.misses.fetch_add(1, std::memory_order_relaxed);
+
+	// parse without holding the lock, another thread may add the word meanwhile
+	auto analyses = std::make_shared<const std::vector<Phrase::ptr>>(parse_word(orth));
+
+	std::unique_lock lock(shard.lock);
+	if (const auto found = shard.index.find(orth); found != shard.index.end())
+		return shard.slots[found->second].analyses;
+
+	size_t victim;
+	if (shard.filled < _shard_capacity)
+		victim = shard.filled++;
+	else
+	{
+		while (shard.slots[shard.hand].used.exchange(false, std::memory_order_relaxed))
+			shard.hand = (shard.hand + 1) % _shard_capacity;
+		victim = shard.hand;
+		shard.hand = (shard.hand + 1) % _shard_capacity;
+		shard.index.erase(shard.slots[victim].orth);
+	}
+	auto& slot = shard.slots[victim];
+	slot.orth = orth;
+	slot.analyses = analyses;
+	slot.used.store(false, std::memory_order_relaxed);
+	shard.index.emplace(slot.orth, victim);
+	return analyses;
+}
+
+size_t WordCache::size() const
+{
+	size_t result = 0;
+	for (auto&& shard : _shards)
+	{
+		std::shared_lock lock(shard.lock);
+		result += shard.index.size();
+	}
+	return result;
+}
+
+size_t WordCache::hits() const
+{
+	size_t result = 0;
+	for (auto&& shard : _shards)
+		result += shard.hits.load(std::memory_order_relaxed);
+	return result;
+}
+
+size_t WordCache::misses() const
+{
+	size_t result = 0;
+	for (auto&& shard : _shards)
+		result += shard.misses.load(std::memory_order_relaxed);
+	return result;
+}
+
+void WordCache::clear()
+{
+	for (auto&& shard : _shards)
+	{
+		std::unique_lock lock(shard.lock);
+		shard.index.clear();
+		for (size_t i = 0; i < shard.filled; ++i)
+		{
+			shard.slots[i].orth.clear();
+			shard.slots[i].analyses.reset();
+			shard.slots[i].used.store(false, std::memory_order_relaxed);
+		}
+		shard.filled = 0;
+		shard.hand = 0;
+		shard.hits.store(0, std::memory_order_relaxed);
+		shard.misses.store(0, std::memory_order_relaxed);
+	}
+}
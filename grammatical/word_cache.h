@@ -0,0 +1,58 @@
+#pragma once
+
+#include "phrase.h"
+
+#include <atomic>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Bounded cache of parse_word results that any number of threads may share.
+// Words are spread over shards by hash, and lookups only take their shard's lock shared.
+// A full shard evicts with CLOCK: the hand passes over the words used since it last came by
+class WordCache
+{
+public:
+	using Analyses = std::shared_ptr<const std::vector<Phrase::ptr>>;
+
+	explicit WordCache(size_t capacity = 1 << 16, unsigned shards = 16);
+
+	WordCache(const WordCache&) = delete;
+	WordCache& operator=(const WordCache&) = delete;
+
+	// the analyses of orth, parsed the first time it is asked for
+	Analyses get(std::string_view orth);
+
+	size_t capacity() const { return _capacity; }
+	size_t size() const;
+	size_t hits() const;
+	size_t misses() const;
+
+	// forgets every word and resets the counters
+	void clear();
+private:
+	struct Slot
+	{
+		std::string orth;
+		Analyses analyses;
+		std::atomic<bool> used{ false };
+	};
+	struct alignas(64) Shard
+	{
+		mutable std::shared_mutex lock;
+		std::unordered_map<std::string_view, size_t> index; // keys point into the slots
+		std::unique_ptr<Slot[]> slots;
+		size_t filled = 0;
+		size_t hand = 0;
+		std::atomic<size_t> hits{ 0 };
+		std::atomic<size_t> misses{ 0 };
+	};
+	const size_t _capacity;
+	const size_t _shard_capacity;
+	std::vector<Shard> _shards;
+
+	Shard& _shard(std::string_view orth) { return _shards[std::hash<std::string_view>()(orth) % _shards.size()]; }
+};
@@ -2,13 +2,23 @@
 #include "ranged.h"
 #include "tokens.h"
 #include "parser.h"
+#include "arena.h"
+#include "lexicon.h"
+#include "mapped_file.h"
+#include "utf8.h"
 
+#include <algorithm>
 #include <cassert>
-#include <cctype>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <unordered_map>
 #include <string>
 #include <fstream>
 #include <iostream>
+#include <type_traits>
 
 
 using std::pair;
@@ -17,40 +27,285 @@ using std::vector;
 using std::string;
 using std::string_view;
 
-template <class C, class T>
-auto find(C&& c, const T& value) -> std::optional<decltype(c.find(value)->second)>
+// The dictionary as a trie over the bytes of the orthographies, 
+// so every morpheme that starts at a position of a word is found in one walk
+class MorphemeTrie
 {
-	if (auto found = c.find(value); found != c.end())
-		return found->second;
-	return {};
+public:
+	// these are also the records of the trie in a compiled lexicon
+	struct Node
+	{
+		uint32_t edges_begin;
+		uint32_t edges_end;
+		uint32_t morphemes_begin;
+		uint32_t morphemes_end;
+	};
+	struct Edge
+	{
+		uint32_t byte;
+		uint32_t node;
+	};
+private:
+	std::vector<Node> _own_nodes;
+	std::vector<Edge> _own_edges;
+	std::vector<uint32_t> _own_morphemes;
+
+	// the arrays in use, the ones above or those of a mapped lexicon
+	const Node* _nodes = nullptr;
+	size_t _node_count = 0;
+	const Edge* _edges = nullptr; // sorted by byte for each node
+	size_t _edge_count = 0;
+	const uint32_t* _morphemes = nullptr; // indices of the morphemes
+	size_t _morpheme_count = 0;
+public:
+	MorphemeTrie() = default;
+	MorphemeTrie(MorphemeTrie&&) = default;
+	MorphemeTrie& operator=(MorphemeTrie&&) = default;
+
+	// morpheme i is spelled orths[i], equal spellings keep their order
+	explicit MorphemeTrie(const std::vector<string_view>& orths)
+	{
+		struct Building
+		{
+			std::map<unsigned char, uint32_t> children;
+			std::vector<uint32_t> morphemes;
+		};
+		std::vector<Building> building(1);
+		for (size_t i = 0; i < orths.size(); ++i)
+		{
+			uint32_t n = 0;
+			for (const char c : orths[i])
+			{
+				const auto found = building[n].children.find(static_cast<unsigned char>(c));
+				if (found != building[n].children.end())
+					n = found->second;
+				else
+				{
+					const auto child = uint32_t(building.size());
+					building[n].children.emplace(static_cast<unsigned char>(c), child);
+					building.emplace_back();
+					n = child;
+				}
+			}
+			building[n].morphemes.emplace_back(uint32_t(i));
+		}
+		_own_nodes.resize(building.size());
+		for (size_t n = 0; n < building.size(); ++n)
+		{
+			auto& node = _own_nodes[n];
+			node.edges_begin = uint32_t(_own_edges.size());
+			for (auto&& [byte, child] : building[n].children)
+				_own_edges.push_back({ byte, child });
+			node.edges_end = uint32_t(_own_edges.size());
+			node.morphemes_begin = uint32_t(_own_morphemes.size());
+			_own_morphemes.insert(_own_morphemes.end(), building[n].morphemes.begin(), building[n].morphemes.end());
+			node.morphemes_end = uint32_t(_own_morphemes.size());
+		}
+		_nodes = _own_nodes.data();
+		_node_count = _own_nodes.size();
+		_edges = _own_edges.data();
+		_edge_count = _own_edges.size();
+		_morphemes = _own_morphemes.data();
+		_morpheme_count = _own_morphemes.size();
+	}
+
+	// uses arrays that live elsewhere, throws if they don't make a trie of morphemes below morpheme_limit
+	MorphemeTrie(const Node* nodes, size_t node_count, const Edge* edges, size_t edge_count, 
+		const uint32_t* morphemes, size_t morpheme_count, size_t morpheme_limit) : 
+		_nodes(nodes), _node_count(node_count), _edges(edges), _edge_count(edge_count), 
+		_morphemes(morphemes), _morpheme_count(morpheme_count)
+	{
+		for (size_t n = 0; n < node_count; ++n)
+		{
+			const auto& node = nodes[n];
+			if (node.edges_begin > node.edges_end || node.edges_end > edge_count ||
+				node.morphemes_begin > node.morphemes_end || node.morphemes_end > morpheme_count)
+				throw std::runtime_error("trie node out of range");
+		}
+		for (size_t e = 0; e < edge_count; ++e)
+			if (edges[e].node >= node_count || edges[e].byte > 0xff)
+				throw std::runtime_error("trie edge out of range");
+		for (size_t m = 0; m < morpheme_count; ++m)
+			if (morphemes[m] >= morpheme_limit)
+				throw std::runtime_error("trie morpheme out of range");
+	}
+
+	const Node* nodes() const { return _nodes; }
+	size_t node_count() const { return _node_count; }
+	const Edge* edges() const { return _edges; }
+	size_t edge_count() const { return _edge_count; }
+	const uint32_t* morphemes() const { return _morphemes; }
+	size_t morpheme_count() const { return _morpheme_count; }
+
+	// calls f(to, morpheme) for every morpheme spelled by orth from from to to, shortest first
+	template <class F>
+	void walk(string_view orth, size_t from, F&& f) const
+	{
+		if (_node_count == 0)
+			return;
+		const Node* node = _nodes;
+		for (size_t to = from; to < orth.size(); ++to)
+		{
+			const auto byte = static_cast<unsigned char>(orth[to]);
+			const auto first = _edges + node->edges_begin;
+			const auto last = _edges + node->edges_end;
+			const auto edge = std::lower_bound(first, last, byte, [](const Edge& e, unsigned char b) { return e.byte < b; });
+			if (edge == last || edge->byte != byte)
+				return;
+			node = _nodes + edge->node;
+			for (auto m = node->morphemes_begin; m < node->morphemes_end; ++m)
+				f(to, _morphemes[m]);
+		}
+	}
+};
+
+// Layout of a compiled lexicon: a header, then arrays of the records below, each at an offset aligned to 8. 
+// Numbers are in the byte order of the machine that compiled it. Records refer to each other by index
+namespace compiled
+{
+	constexpr char magic[8] = { 'g', 'r', 'a', 'm', 'l', 'e', 'x', '\0' };
+	constexpr uint32_t version = 1;
+	constexpr uint32_t byte_order = 0x01020304;
+	constexpr uint32_t none = ~0u;
+
+	struct Section
+	{
+		uint64_t offset;
+		uint64_t count;
+	};
+	struct Header
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t byte_order;
+		Section strings; // char
+		Section sem; // uint32_t, lexeme indices
+		Section arguments; // Argument
+		Section lexemes; // Lexeme
+		Section morphemes; // Morpheme
+		Section nodes; // MorphemeTrie::Node
+		Section edges; // MorphemeTrie::Edge
+		Section entries; // uint32_t, morpheme indices
+	};
+	struct Argument
+	{
+		uint32_t syn;
+		uint32_t sem; // or none
+		uint8_t rel;
+		uint8_t mark;
+		uint8_t padding[2];
+	};
+	struct Lexeme
+	{
+		uint32_t name; // offset into strings
+		uint32_t name_size;
+		uint32_t sem;
+		uint32_t sem_count;
+		uint32_t args;
+		uint32_t args_count;
+	};
+	struct Morpheme
+	{
+		uint32_t orth; // offset into strings
+		uint32_t orth_size;
+		uint32_t syn;
+		uint32_t sem; // or none
+		uint32_t args;
+		uint32_t args_count;
+	};
 }
 
-static bool ignore_case_less(string_view a, string_view b)
+void number_lexemes(const std::vector<shared_ptr<Lexeme>>& lexemes)
 {
-	auto ita = a.begin(); const auto enda = a.end();
-	auto itb = b.begin(); const auto endb = b.end();
-	for (; ita != enda; ++ita, ++itb)
-	{
-		if (itb == endb) return false;
-		const auto ca = std::tolower(*ita);
-		const auto cb = std::tolower(*itb);
-		if (cb < ca) return false;
-		if (ca < cb) return true;
+	const size_t words = (lexemes.size() + 63) / 64;
+	const auto bit = [](std::vector<uint64_t>& bits, size_t n) { bits[n / 64] |= uint64_t(1) << n % 64; };
+
+	std::unordered_map<const Lexeme*, size_t> numbers;
+	for (auto&& lex : lexemes)
+		numbers.emplace(lex.get(), numbers.size());
+
+	// in the lexicon a lexeme can only be something loaded before it, elsewhere the lexemes on a cycle through sem get no number
+	enum class State : char { unseen, visiting, done, failed };
+	std::vector<State> state(lexemes.size(), State::unseen);
+	std::vector<std::vector<uint64_t>> closures(lexemes.size());
+	const auto close = [&](auto& self, size_t n) -> bool
+	{
+		if (state[n] != State::unseen)
+			return state[n] == State::done;
+		state[n] = State::visiting;
+		auto& closure = closures[n];
+		closure.assign(words, 0);
+		bit(closure, n);
+		for (auto&& e : lexemes[n]->sem)
+		{
+			const auto found = numbers.find(e.get());
+			if (found == numbers.end() || !self(self, found->second))
+			{
+				state[n] = State::failed;
+				return false;
+			}
+			for (size_t i = 0; i < words; ++i)
+				closure[i] |= closures[found->second][i];
+		}
+		state[n] = State::done;
+		return true;
+	};
+	for (size_t n = 0; n < lexemes.size(); ++n)
+		close(close, n);
+
+	for (size_t n = 0; n < lexemes.size(); ++n) if (state[n] == State::done)
+	{
+		auto& lex = *lexemes[n];
+		lex.number = n;
+		lex.closure = move(closures[n]);
+		if (!lex.name.empty())
+			continue;
+		std::vector<uint64_t> signature(words, 0);
+		bool named = true;
+		for (auto&& part : lex.sem)
+			if (const auto found = numbers.find(part.get()); found != numbers.end() && !part->name.empty())
+				bit(signature, found->second);
+			else
+				named = false;
+		if (named)
+			lex.signature = move(signature);
 	}
-	return itb != endb;
 }
 
 struct Data
 {
 	std::unordered_multimap<string, Lexeme::ptr> lexicon;
-	std::unordered_multimap<string, Phrase::ptr> dictionary;
+	MorphemeTrie trie;
+	// the compiled lexicon the trie is in, if the lexicon was loaded from one
+	MappedFile file;
+
+	// The lexicon owns its lexemes and morphemes and lives until the program exits, 
+	// everything else borrows them and copies them without reference counting. 
+	// Mutable because a compiled lexicon fills them in as it is read
+	mutable std::vector<std::shared_ptr<const void>> owned;
+
+	// every lexeme and morpheme kept, in the order they were made
+	mutable std::vector<shared_ptr<Lexeme>> lexemes;
+	mutable std::vector<shared_ptr<Morpheme>> morphemes;
+
+	template <class T>
+	shared_ptr<T> keep(shared_ptr<T> p)
+	{
+		owned.emplace_back(p);
+		auto result = borrowed(p);
+		if constexpr (std::is_same_v<T, Lexeme>)
+			lexemes.emplace_back(result);
+		if constexpr (std::is_same_v<T, Morpheme>)
+			morphemes.emplace_back(result);
+		return result;
+	}
 
-	using Input = std::ifstream;
+	using Input = MappedFile;
 
 	template <class... Args>
 	void addLex(string name, const Args&... args) 
 	{
-		auto lex = std::make_shared<Lexeme>(name);
+		auto lex = keep(std::make_shared<Lexeme>(name));
 		(lex->become(lexicon.equal_range(args) | ranged::values), ...);
 		lexicon.emplace(lex->name, lex); 
 	}
@@ -63,23 +318,23 @@ struct Data
 		//addLex("action");
 	}
 
-	auto get_lex(const string& key) const
+	auto get_lex(string_view key) const
 	{
-		auto range = lexicon.equal_range(key);
+		auto range = lexicon.equal_range(string(key));
 		if (range.first == range.second)
-			throw std::runtime_error("lexeme '" + key + "' not found");
+			throw std::runtime_error("lexeme '" + string(key) + "' not found");
 
 		Lexeme::ptr lex = range.first->second;
 
 		if (++range.first != range.second)
-			throw std::runtime_error("ignoring ambiguous lexeme '" + key + "' referred");
+			throw std::runtime_error("ignoring ambiguous lexeme '" + string(key) + "' referred");
 
 		return lex;
 	}
 
-	Shape read_dotlist(TokenIterator<Input>& it) const
+	Shape read_dotlist(TokenIterator<Input>& it)
 	{
-		static const std::unordered_map<string, Tags> tag_lookup =
+		static constexpr auto tag_lookup = make_perfect_hash<Tags>(
 		{
 			{ "suffix", Tag::suffix },
 		{ "prep", Tag::prep },
@@ -96,18 +351,18 @@ struct Data
 		{ "prespl", {Tag::fin, Tag::pres, tags::nonsg3, Tag::dict} },
 		{ "modalpres", {Tag::modal, Tag::fin, Tag::pres} }, // | tags::sg3 | tags::nonsg3 },
 		{ "modalpast", {Tag::modal, Tag::fin, Tag::past} }
-		};
+		});
 		Shape result;
 		shared_ptr<Lexeme> meta;
 		for (;; ++it)
 		{
-			string key = *it; ++it;
+			const string_view key = *it; ++it;
 			if (auto value = mark(key); value && *value != Mark::None)
 			{
 				assert(result.mark == Mark::None);
 				result.mark = *value;
 			}
-			else if (auto value = find(tag_lookup, key))
+			else if (auto value = tag_lookup.find(key))
 			{
 				result.syn.insert(*value);
 			}
@@ -119,7 +374,7 @@ struct Data
 			{
 				if (!meta)
 				{
-					meta = std::make_shared<Lexeme>("");
+					meta = keep(std::make_shared<Lexeme>(""));
 					meta->become(move(result.sem));
 					result.sem = meta;
 				}
@@ -131,7 +386,7 @@ struct Data
 	}
 
 	template <class T>
-	void parse_arg(Rel rel, TokenIterator<Input>& it, const shared_ptr<T>& m) const
+	void parse_arg(Rel rel, TokenIterator<Input>& it, const shared_ptr<T>& m)
 	{
 		for (;; ++it)
 		{
@@ -148,7 +403,7 @@ struct Data
 		if (it.isNewline() || it.isWhitespace()) ++it;
 		if (!it) return nullptr;
 		const auto key = *it;
-		const auto item = std::make_shared<T>(key);
+		const auto item = keep(std::make_shared<T>(string(key)));
 		if ((++it).skipws()) return item;
 
 		try
@@ -173,12 +428,12 @@ struct Data
 				default:
 					break;
 				}
-				if (isalnum(it->front()))
+				if (utf8::starts_word(*it))
 				{
 					item->update(read_dotlist(it));
 					continue;
 				}
-				throw std::runtime_error("unexpected relation '" + *it + "'");
+				throw std::runtime_error("unexpected relation '" + string(*it) + "'");
 				break;
 			}
 			while (it && !it.isNewline())
@@ -194,73 +449,364 @@ struct Data
 		return item;
 	}
 
-};
-
-
-
+	void build_trie()
+	{
+		std::vector<string_view> orths;
+		orths.reserve(morphemes.size());
+		for (auto&& m : morphemes)
+			orths.emplace_back(m->orth);
+		trie = MorphemeTrie(orths);
+	}
 
-std::vector<Phrase::ptr> parse_word(string_view orth)
-{
-	static const auto data = [&]
+	static Data from_text()
 	{
 		Data result;
 		int line = 1;
-		for (TokenIterator<std::ifstream> it("lexemes.txt"); it; ++it, ++line)
+		for (TokenIterator<Input> it("lexemes.txt"); it; ++it, ++line)
 		{
 			if (auto lex = result.parse<Lexeme>(it, line))
 				result.lexicon.emplace(lex->name, lex);
 		}
 		line = 1;
-		for (TokenIterator<std::ifstream> it("words.txt"); it; ++it, ++line)
-		{
-			if (auto m = result.parse<Morpheme>(it, line))
-				result.dictionary.emplace(m->orth, m);
-		}
+		for (TokenIterator<Input> it("words.txt"); it; ++it, ++line)
+			result.parse<Morpheme>(it, line);
+		number_lexemes(result.lexemes);
+		result.build_trie();
 		return result;
-	}();
-	struct OrthParser
+	}
+
+	// Made the first time they are asked for when the lexicon is compiled, see from_compiled
+	const shared_ptr<Lexeme>& lexeme(size_t i) const
+	{
+		if (records)
+			std::call_once(made[i], [&] { make_lexeme(i); });
+		return lexemes[i];
+	}
+	const shared_ptr<Morpheme>& morpheme(size_t m) const
+	{
+		if (records)
+			std::call_once(made[lexemes.size() + m], [&] { make_morpheme(m); });
+		return morphemes[m];
+	}
+
+	// The records of a compiled lexicon are checked when it is loaded and then used where they are in the file. 
+	// A lexeme or morpheme is only made from its record when a word needs it, with the number, closure 
+	// and signature number_lexemes would give it, so loading doesn't grow with the size of the lexicon
+	static Data from_compiled(const string& path)
 	{
-		Parser parser;
-		uint64_t checked = 0;
-		const string_view orth;
+		Data result;
+		result.file = MappedFile(path);
+		const auto& file = result.file;
+
+		compiled::Header header;
+		if (file.size() < sizeof(header))
+			throw std::runtime_error(path + " is too small to be a compiled lexicon");
+		std::memcpy(&header, file.data(), sizeof(header));
+		if (std::memcmp(header.magic, compiled::magic, sizeof(header.magic)) != 0)
+			throw std::runtime_error(path + " is not a compiled lexicon");
+		if (header.version != compiled::version || header.byte_order != compiled::byte_order)
+			throw std::runtime_error(path + " was compiled by another version or on another kind of machine");
 
-		OrthParser(string_view orth) : orth(orth) { }
+		const auto damaged = [&] { return std::runtime_error(path + " is damaged"); };
+		const auto section = [&](const compiled::Section& s, auto* type)
+		{
+			using T = std::remove_pointer_t<decltype(type)>;
+			if (s.offset % alignof(T) != 0 || s.offset > file.size() || s.count > (file.size() - s.offset) / sizeof(T))
+				throw damaged();
+			return reinterpret_cast<const T*>(file.data() + s.offset);
+		};
+		Records records;
+		records.strings = section(header.strings, (char*)nullptr);
+		records.sem = section(header.sem, (uint32_t*)nullptr);
+		records.arguments = section(header.arguments, (compiled::Argument*)nullptr);
+		records.lexemes = section(header.lexemes, (compiled::Lexeme*)nullptr);
+		records.morphemes = section(header.morphemes, (compiled::Morpheme*)nullptr);
+		records.words = (header.lexemes.count + 63) / 64;
 
-		void maybe_parse_rest(int from) // assuming this function will be inlined
+		const auto check = [&](uint64_t begin, uint64_t count, uint64_t size)
+		{
+			if (begin > size || count > size - begin)
+				throw damaged();
+		};
+		const auto check_lexeme = [&](uint32_t i, bool optional)
+		{
+			if (!(optional && i == compiled::none) && i >= header.lexemes.count)
+				throw damaged();
+		};
+		for (auto&& a : ranged::range(records.arguments, records.arguments + header.arguments.count))
+		{
+			if (a.rel > static_cast<uint8_t>(Rel::bicomp) || a.mark > static_cast<uint8_t>(Mark::For))
+				throw damaged();
+			check_lexeme(a.sem, true);
+		}
+		for (auto&& record : ranged::range(records.lexemes, records.lexemes + header.lexemes.count))
+		{
+			check(record.name, record.name_size, header.strings.count);
+			check(record.sem, record.sem_count, header.sem.count);
+			for (auto s = record.sem; s < record.sem + record.sem_count; ++s)
+				check_lexeme(records.sem[s], false);
+			check(record.args, record.args_count, header.arguments.count);
+		}
+		for (auto&& record : ranged::range(records.morphemes, records.morphemes + header.morphemes.count))
 		{
-			if ((checked & (1 << from)) == 0)
-				parse_rest(from);
+			check(record.orth, record.orth_size, header.strings.count);
+			check_lexeme(record.sem, true);
+			check(record.args, record.args_count, header.arguments.count);
 		}
 
-		void parse_rest(int from)
+		// Making a lexeme makes the ones in its sem and arguments first, which the text 
+		// only allows to be lexemes read before it, or made for it. A cycle would never end
+		enum class State : char { unseen, visiting, done };
+		std::vector<State> state(header.lexemes.count, State::unseen);
+		std::vector<std::pair<uint32_t, uint32_t>> stack; // lexeme, how many of what it refers to are done
+		const auto refers_to = [&](uint32_t n, uint32_t k) -> uint32_t
+		{
+			const auto& record = records.lexemes[n];
+			return k < record.sem_count ? records.sem[record.sem + k] : records.arguments[record.args + k - record.sem_count].sem;
+		};
+		for (uint32_t first = 0; first < header.lexemes.count; ++first) if (state[first] == State::unseen)
 		{
-			checked |= (1 << from);
-			for (int to = from; to < orth.size(); ++to)
-				for (auto&& e : data.dictionary.equal_range(string(orth.substr(from, to+1 - from))) | ranged::values)
+			stack.emplace_back(first, 0);
+			state[first] = State::visiting;
+			while (!stack.empty())
+			{
+				auto& [n, k] = stack.back();
+				if (k == records.lexemes[n].sem_count + records.lexemes[n].args_count)
 				{
-					parser.insert(e, from, to);
-					maybe_parse_rest(to+1);
+					state[n] = State::done;
+					stack.pop_back();
+					continue;
 				}
+				const auto next = refers_to(n, k++);
+				if (next == compiled::none || state[next] == State::done)
+					continue;
+				if (state[next] == State::visiting)
+					throw damaged();
+				state[next] = State::visiting;
+				stack.emplace_back(next, 0);
+			}
 		}
 
-		std::vector<Phrase::ptr> parse()
+		result.records = records;
+		result.owned.resize(header.lexemes.count + header.morphemes.count);
+		result.lexemes.resize(header.lexemes.count);
+		result.morphemes.resize(header.morphemes.count);
+		result.made = std::make_unique<std::once_flag[]>(header.lexemes.count + header.morphemes.count);
+		result.trie = MorphemeTrie(
+			section(header.nodes, (MorphemeTrie::Node*)nullptr), header.nodes.count,
+			section(header.edges, (MorphemeTrie::Edge*)nullptr), header.edges.count,
+			section(header.entries, (uint32_t*)nullptr), header.entries.count, 
+			result.morphemes.size());
+		return result;
+	}
+
+	struct Records
+	{
+		const char* strings;
+		const uint32_t* sem;
+		const compiled::Argument* arguments;
+		const compiled::Lexeme* lexemes;
+		const compiled::Morpheme* morphemes;
+		size_t words; // of a closure
+	};
+	std::optional<Records> records;
+	// one for each lexeme, then one for each morpheme, set once it is made
+	std::unique_ptr<std::once_flag[]> made;
+
+	Lexeme::ptr optional_lexeme(uint32_t i) const { return i == compiled::none ? nullptr : Lexeme::ptr(lexeme(i)); }
+
+	void read_args(uint32_t begin, uint32_t count, Bag<Argument>& args) const
+	{
+		for (auto&& a : ranged::range(records->arguments + begin, records->arguments + begin + count))
+			args.emplace(static_cast<Rel>(a.rel), Shape(static_cast<Mark>(a.mark), Tags::fromBits(a.syn), optional_lexeme(a.sem)));
+	}
+
+	void make_lexeme(size_t i) const
+	{
+		const auto& record = records->lexemes[i];
+		auto lex = std::make_shared<Lexeme>(string(records->strings + record.name, record.name_size));
+		for (auto s = record.sem; s < record.sem + record.sem_count; ++s)
+			lex->sem.emplace_back(lexeme(records->sem[s]));
+		read_args(record.args, record.args_count, lex->args);
+
+		const auto bit = [](std::vector<uint64_t>& bits, size_t n) { bits[n / 64] |= uint64_t(1) << n % 64; };
+		lex->number = i;
+		lex->closure.assign(records->words, 0);
+		bit(lex->closure, i);
+		for (auto&& e : lex->sem)
+			for (size_t w = 0; w < records->words; ++w)
+				lex->closure[w] |= e->closure[w];
+		if (lex->name.empty() && std::none_of(lex->sem.begin(), lex->sem.end(), [](auto& part) { return part->name.empty(); }))
 		{
-			assert(orth.size() < sizeof(checked)*8);
-			parse_rest(0);
+			lex->signature.emplace(records->words, 0);
+			for (auto&& part : lex->sem)
+				bit(*lex->signature, part->number);
+		}
+		owned[i] = lex;
+		lexemes[i] = borrowed(lex);
+	}
 
-			auto results = parser.run();
-			if (parser.length() == orth.size())
-			{
-				std::vector<Phrase::ptr> result;
-				result.reserve(results.size());
-				for (auto&& r : results)
-					if (r.size() == 1)
-						result.emplace_back(std::make_shared<Word>(r.front()->sem, r.front()));
-				return result;
-			}
-			return {};
+	void make_morpheme(size_t m) const
+	{
+		const auto& record = records->morphemes[m];
+		auto morph = std::make_shared<Morpheme>(string(records->strings + record.orth, record.orth_size));
+		morph->update(Tags::fromBits(record.syn), optional_lexeme(record.sem));
+		// the arguments from sem that update adds are already among the morpheme's own
+		morph->args = {};
+		read_args(record.args, record.args_count, morph->args);
+		owned[lexemes.size() + m] = morph;
+		morphemes[m] = borrowed(morph);
+	}
+};
+
+static string& compiled_lexicon()
+{
+	static string path;
+	return path;
+}
+
+void set_compiled_lexicon(std::string path)
+{
+	compiled_lexicon() = move(path);
+}
+
+void compile_lexicon(const std::string& path)
+{
+	const auto data = Data::from_text();
+
+	std::unordered_map<const Lexeme*, uint32_t> numbers;
+	for (auto&& lex : data.lexemes)
+		numbers.emplace(lex.get(), uint32_t(numbers.size()));
+	const auto number = [&](const Lexeme::ptr& lex)
+	{
+		if (!lex)
+			return compiled::none;
+		const auto found = numbers.find(lex.get());
+		if (found == numbers.end())
+			throw std::runtime_error("lexeme '" + lex->name + "' is not part of the lexicon");
+		return found->second;
+	};
+
+	string strings;
+	std::vector<uint32_t> sem;
+	std::vector<compiled::Argument> arguments;
+	std::vector<compiled::Lexeme> lexemes;
+	std::vector<compiled::Morpheme> morphemes;
+
+	const auto add_text = [&](const string& s)
+	{
+		const auto at = uint32_t(strings.size());
+		strings += s;
+		return at;
+	};
+	const auto add_args = [&](const Bag<Argument>& args)
+	{
+		const auto at = uint32_t(arguments.size());
+		for (auto&& a : args)
+		{
+			compiled::Argument record = {};
+			record.syn = a.syn.bits();
+			record.sem = number(a.sem);
+			record.rel = static_cast<uint8_t>(a.rel);
+			record.mark = static_cast<uint8_t>(a.mark);
+			arguments.push_back(record);
 		}
+		return at;
+	};
+	for (auto&& lex : data.lexemes)
+	{
+		compiled::Lexeme record = {};
+		record.name = add_text(lex->name);
+		record.name_size = uint32_t(lex->name.size());
+		record.sem = uint32_t(sem.size());
+		record.sem_count = uint32_t(lex->sem.size());
+		for (auto&& s : lex->sem)
+			sem.push_back(number(s));
+		record.args = add_args(lex->args);
+		record.args_count = uint32_t(lex->args.size());
+		lexemes.push_back(record);
+	}
+	for (auto&& m : data.morphemes)
+	{
+		compiled::Morpheme record = {};
+		record.orth = add_text(m->orth);
+		record.orth_size = uint32_t(m->orth.size());
+		record.syn = m->syn.bits();
+		record.sem = number(m->sem);
+		record.args = add_args(m->args);
+		record.args_count = uint32_t(m->args.size());
+		morphemes.push_back(record);
+	}
+
+	compiled::Header header = {};
+	std::memcpy(header.magic, compiled::magic, sizeof(header.magic));
+	header.version = compiled::version;
+	header.byte_order = compiled::byte_order;
+
+	std::vector<std::pair<const void*, size_t>> parts;
+	uint64_t offset = sizeof(header);
+	const auto place = [&](compiled::Section& section, const void* data, size_t count, size_t size)
+	{
+		offset = (offset + 7) / 8 * 8;
+		section = { offset, count };
+		parts.emplace_back(data, count * size);
+		offset += count * size;
 	};
+	place(header.strings, strings.data(), strings.size(), 1);
+	place(header.sem, sem.data(), sem.size(), sizeof(uint32_t));
+	place(header.arguments, arguments.data(), arguments.size(), sizeof(compiled::Argument));
+	place(header.lexemes, lexemes.data(), lexemes.size(), sizeof(compiled::Lexeme));
+	place(header.morphemes, morphemes.data(), morphemes.size(), sizeof(compiled::Morpheme));
+	place(header.nodes, data.trie.nodes(), data.trie.node_count(), sizeof(MorphemeTrie::Node));
+	place(header.edges, data.trie.edges(), data.trie.edge_count(), sizeof(MorphemeTrie::Edge));
+	place(header.entries, data.trie.morphemes(), data.trie.morpheme_count(), sizeof(uint32_t));
+
+	std::ofstream out(path, std::ios::binary);
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	uint64_t written = sizeof(header);
+	for (size_t i = 0; i < parts.size(); ++i)
+	{
+		static const char zeros[8] = {};
+		const auto& section = (&header.strings)[i];
+		out.write(zeros, std::streamsize(section.offset - written));
+		out.write(static_cast<const char*>(parts[i].first), std::streamsize(parts[i].second));
+		written = section.offset + parts[i].second;
+	}
+	if (!out)
+		throw std::runtime_error("could not write " + path);
+}
+
+// The chart parse of a whole word from the morphemes that spell it
+static std::vector<Phrase::ptr> parse_morphemes(const Data& data, string_view orth)
+{
+	Parser parser;
+
+	// positions that the morphemes found so far reach from the start of the word
+	std::vector<char> reached(orth.size() + 1, false);
+	reached[0] = true;
+	for (size_t from = 0; from < orth.size(); ++from) if (reached[from])
+		data.trie.walk(orth, from, [&](size_t to, uint32_t m)
+		{
+			parser.insert(data.morpheme(m), int(from), int(to));
+			reached[to + 1] = true;
+		});
+
+	// every parse of the whole word as one phrase, the covers of anything else are never made
+	parser.build();
+	std::vector<Phrase::ptr> result;
+	auto covers = parser.covers();
+	if (const auto best = covers.cost(); parser.length() == orth.size() && best && best->first == 1)
+		while (covers.cost() == best)
+		{
+			const auto cover = *covers.next();
+			result.emplace_back(std::make_shared<Word>(cover.front()->sem, cover.front()));
+		}
+	return result;
+}
+
+std::vector<Phrase::ptr> parse_word(string_view orth)
+{
+	static const auto data = compiled_lexicon().empty() ? Data::from_text() : Data::from_compiled(compiled_lexicon());
 
-	return OrthParser{ orth }.parse();
+	return parse_morphemes(data, orth);
 }